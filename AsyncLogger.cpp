@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////
+// AsyncLogger.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "AsyncLogger.h"
+#include "ThreadPlacement.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+AsyncLogger::AsyncLogger()
+    : mMode(MODE_SYNC),
+      mPolicy(POLICY_DROP),
+      mThread(nullptr),
+      mStop(false),
+      mPushing(0),
+      mDropped(0)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+AsyncLogger::~AsyncLogger()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// singleton
+//////////////////////////////////////////////////////////////////////////
+AsyncLogger &AsyncLogger::get()
+{
+    static AsyncLogger logger;
+    return(logger);
+}
+//////////////////////////////////////////////////////////////////////////
+// init
+//////////////////////////////////////////////////////////////////////////
+bool AsyncLogger::init(int mode,int policy,size_t capacity)
+{
+    // checks
+    if(mThread)
+        return(false);
+    mPolicy=policy;
+    // synchronous or disabled
+    if(mode!=MODE_ASYNC)
+    {
+        mMode.store(mode);
+        return(true);
+    }
+    // create queue and entries pool
+    if(!mQueue.init(capacity,RingQueue<Entry*>::WAIT_BLOCK) || !mEntries.init(capacity,0))
+        return(false);
+    // start writer
+    mStop.store(false);
+    mThread=new std::thread(&AsyncLogger::funcWrapWrite,this);
+    mMode.store(MODE_ASYNC);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown, queued messages are written
+//////////////////////////////////////////////////////////////////////////
+void AsyncLogger::shutdown()
+{
+    // checks
+    if(mThread==nullptr)
+        return;
+    // new messages go straight to Logger
+    mMode.store(MODE_SYNC);
+    // wait for producers which saw asynchronous mode, their messages are drained by writer
+    while(mPushing.load()!=0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // stop writer
+    mStop.store(true);
+    mQueue.shutdown();
+    mThread->join();
+    delete(mThread);
+    mThread=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// log message
+//////////////////////////////////////////////////////////////////////////
+void AsyncLogger::log(const char *fmt,...)
+{
+    va_list args;
+    char    text[ENTRY_TEXT];
+    Entry  *entry;
+    int     mode=mMode.load(std::memory_order_relaxed);
+    // checks
+    if(fmt==nullptr || mode==MODE_OFF)
+        return;
+    // asynchronous mode, mode is checked again once producer is counted
+    if(mode==MODE_ASYNC)
+    {
+        mPushing.fetch_add(1);
+        if(mMode.load()==MODE_ASYNC && (entry=mEntries.alloc())!=nullptr)
+        {
+            // format on caller side, arguments may not outlive the call
+            va_start(args,fmt);
+            _vsnprintf_s(entry->text,_countof(entry->text),_TRUNCATE,fmt,args);
+            va_end(args);
+            // enqueue
+            if(!(mPolicy==POLICY_BLOCK ? mQueue.push(entry) : mQueue.tryPush(entry)))
+            {
+                // queue is full
+                mDropped.fetch_add(1,std::memory_order_relaxed);
+                mEntries.release(entry);
+            }
+            mPushing.fetch_sub(1);
+            return;
+        }
+        mPushing.fetch_sub(1);
+    }
+    // synchronous mode, format on stack
+    va_start(args,fmt);
+    _vsnprintf_s(text,_countof(text),_TRUNCATE,fmt,args);
+    va_end(args);
+    Logger::get().log("%s",text);
+}
+//////////////////////////////////////////////////////////////////////////
+// writer thread
+//////////////////////////////////////////////////////////////////////////
+void AsyncLogger::funcWrapWrite(void *param)
+{
+    if(param)
+        static_cast<AsyncLogger*>(param)->runWrite();
+}
+void AsyncLogger::runWrite()
+{
+    Entry *entry;
+    UINT64 dropped=0;
+    // name and pin writer
+    ThreadPlacement::get().apply(ThreadPlacement::ROLE_SERVICE,1);
+    // write until stopped and drained
+    for(;;)
+    {
+        if(!mQueue.pop(entry,100))
+        {
+            if(mStop.load())
+                break;
+        }
+        else
+        {
+            Logger::get().log("%s",entry->text);
+            mEntries.release(entry);
+        }
+        // report dropped messages
+        UINT64 total=mDropped.load(std::memory_order_relaxed);
+        if(total!=dropped)
+        {
+            Logger::get().log("async logger: %I64u messages dropped",total-dropped);
+            dropped=total;
+        }
+    }
+    // drain remaining messages
+    while(mQueue.tryPop(entry))
+    {
+        Logger::get().log("%s",entry->text);
+        mEntries.release(entry);
+    }
+}
@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////
+// AsyncLogger.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "RingQueue.h"
+#include "ObjectPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// non-blocking front-end of Logger for hot paths
+//////////////////////////////////////////////////////////////////////////
+class AsyncLogger
+{
+public:
+    // logging modes
+    enum EnMode
+    {
+        MODE_OFF  =0,               // messages are discarded
+        MODE_SYNC =1,               // messages go straight to Logger
+        MODE_ASYNC=2                // messages are written by background thread
+    };
+    // full queue policies
+    enum EnPolicy
+    {
+        POLICY_DROP =0,             // drop message and count it
+        POLICY_BLOCK=1              // wait for free space
+    };
+
+private:
+    // constants
+    enum constants
+    {
+        ENTRY_TEXT=512                  // formatted message size
+    };
+    // formatted message
+    struct Entry
+    {
+        char        text[ENTRY_TEXT];
+    };
+    // mode and policy
+    std::atomic<int> mMode;
+    int             mPolicy;
+    // messages queue and entries pool
+    RingQueue<Entry*> mQueue;
+    ObjectPool<Entry> mEntries;
+    // writer thread
+    std::thread    *mThread;
+    std::atomic<bool> mStop;
+    // producers inside asynchronous path, writer is stopped only after they leave
+    std::atomic<UINT> mPushing;
+    // counters
+    std::atomic<UINT64> mDropped;
+
+public:
+    // singleton
+    static AsyncLogger &get();
+    // init/shutdown
+    bool            init(int mode,int policy,size_t capacity);
+    void            shutdown();
+    // log message
+    void            log(const char *fmt,...);
+    // dropped messages
+    UINT64          dropped() const { return(mDropped.load()); }
+
+private:
+    // ctor/dtor
+    AsyncLogger();
+    ~AsyncLogger();
+    // writer thread
+    static void     funcWrapWrite(void *param);
+    void            runWrite();
+};
@@ -0,0 +1,255 @@
+//////////////////////////////////////////////////////////////////////////
+// Backpressure.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Backpressure.h"
+#include "AsyncLogger.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+Backpressure::Backpressure()
+    : mShedding(false),
+      mDraining(0),
+      mEpisodes(0),
+      mBlocked(0),
+      mShedGauge(nullptr)
+{
+    memset(&mSettings,0,sizeof(mSettings));
+    for(int i=0;i<=ACTION_SPOOL;i++)
+    {
+        mActions[i].store(0);
+        for(int j=0;j<CLASS_COUNT;j++)
+            mShed[i][j]=nullptr;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+Backpressure::~Backpressure()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// init
+//////////////////////////////////////////////////////////////////////////
+bool Backpressure::init(const Settings &settings,DepthFunc depth)
+{
+    static const char *classes[CLASS_COUNT]={ "quote","margin","trade","user","config" };
+    static const char *actions[ACTION_SPOOL+1]={ "enqueue","conflate","drop","coalesce","spool" };
+    // checks
+    if(!depth || settings.high==0 || settings.low>=settings.high)
+    {
+        Logger::get().log("'backpressure': invalid watermarks %u/%u",(UINT)settings.low,(UINT)settings.high);
+        return(false);
+    }
+    // trades, users and config objects must not be lost or overtaken by older queued ones,
+    // spool is written ahead of the queue so it is not allowed either
+    for(int i=0;i<CLASS_COUNT;i++)
+        if(ordered(i) && settings.policy[i]!=POLICY_PASS && settings.policy[i]!=POLICY_BLOCK)
+        {
+            Logger::get().log("'backpressure': trades, users and config objects may only pass or block");
+            return(false);
+        }
+    mSettings=settings;
+    mDepth   =depth;
+    // metrics
+    mShedGauge=Metrics::get().gauge("replication_shedding","","1 while transaction queue is above high watermark");
+    for(int i=ACTION_CONFLATE;i<=ACTION_SPOOL;i++)
+        for(int j=0;j<CLASS_COUNT;j++)
+            mShed[i][j]=Metrics::get().counter("replication_shed_total",std::string("type=\"")+classes[j]+"\",action=\""+actions[i]+"\"","Transactions shed while queue was above high watermark");
+    Logger::get().log("'backpressure': watermarks %u/%u, policies quote %d, margin %d, trade %d, user %d, config %d",
+                      (UINT)mSettings.low,(UINT)mSettings.high,mSettings.policy[CLASS_QUOTE],mSettings.policy[CLASS_MARGIN],
+                      mSettings.policy[CLASS_TRADE],mSettings.policy[CLASS_USER],mSettings.policy[CLASS_CONFIG]);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// admission of transaction
+//////////////////////////////////////////////////////////////////////////
+int Backpressure::admit(int type)
+{
+    // checks
+    if(!mDepth || type<0 || type>=CLASS_COUNT)
+        return(ACTION_ENQUEUE);
+    // below watermarks
+    if(!check(mDepth()))
+        return(ACTION_ENQUEUE);
+    // apply policy
+    switch(mSettings.policy[type])
+    {
+        case POLICY_CONFLATE: return(action(type,ACTION_CONFLATE));
+        case POLICY_DROP:     return(action(type,ACTION_DROP));
+        case POLICY_COALESCE: return(action(type,ACTION_COALESCE));
+        case POLICY_SPOOL:    return(action(type,ACTION_SPOOL));
+        case POLICY_BLOCK:
+        {
+            std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(mSettings.block);
+            mBlocked.fetch_add(1,std::memory_order_relaxed);
+            // wait for consumers, short timeout covers missed notifications,
+            // ordered classes wait without deadline
+            std::unique_lock<std::mutex> lock(mWaitSync);
+            while(check(mDepth()))
+            {
+                if(!ordered(type) && std::chrono::steady_clock::now()>=deadline)
+                    return(action(type,ACTION_SPOOL));
+                mWaitCond.wait_for(lock,std::chrono::milliseconds(10));
+            }
+            return(ACTION_ENQUEUE);
+        }
+        default:
+            break;
+    }
+    return(ACTION_ENQUEUE);
+}
+//////////////////////////////////////////////////////////////////////////
+// admission of margin level, newer level must not overtake coalesced one
+//////////////////////////////////////////////////////////////////////////
+int Backpressure::admit(int sid,const TransMargin *trans)
+{
+    bool pending;
+    // checks
+    if(trans==nullptr)
+        return(admit(CLASS_MARGIN));
+    // lock
+    mSync.lock();
+    pending=mDraining.load()>0 || mMargins.find(key(sid,trans->data.login))!=mMargins.end();
+    // unlock
+    mSync.unlock();
+    // keep account in coalesce map until its level is handed over
+    if(pending)
+        return(action(CLASS_MARGIN,ACTION_COALESCE));
+    return(admit(CLASS_MARGIN));
+}
+//////////////////////////////////////////////////////////////////////////
+// consumer progress
+//////////////////////////////////////////////////////////////////////////
+void Backpressure::drained()
+{
+    // checks
+    if(!mDepth || !mShedding.load(std::memory_order_relaxed))
+        return;
+    // wake producers once shedding stops
+    if(!check(mDepth()))
+    {
+        std::lock_guard<std::mutex> lock(mWaitSync);
+        mWaitCond.notify_all();
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// keep newest margin level
+//////////////////////////////////////////////////////////////////////////
+void Backpressure::coalesce(int sid,const TransMargin *trans)
+{
+    // checks
+    if(trans==nullptr)
+        return;
+    // lock
+    mSync.lock();
+    mMargins[key(sid,trans->data.login)]=*trans;
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// hand coalesced margin levels over, newer levels are coalesced meanwhile
+//////////////////////////////////////////////////////////////////////////
+size_t Backpressure::drain(const HandoverFunc &handover)
+{
+    TransMarginCoalesced margins;
+    // still above low watermark
+    if(!handover || mShedding.load(std::memory_order_relaxed))
+        return(0);
+    // lock
+    mSync.lock();
+    if(mMargins.empty())
+    {
+        mSync.unlock();
+        return(0);
+    }
+    margins.swap(mMargins);
+    mDraining.fetch_add(1);
+    // unlock
+    mSync.unlock();
+    // hand over without lock, admit() keeps coalescing until it is done
+    for(TransMarginCoalesced::const_iterator it=margins.begin();it!=margins.end();++it)
+        handover((int)(it->first>>32),&it->second);
+    mDraining.fetch_sub(1);
+    return(margins.size());
+}
+//////////////////////////////////////////////////////////////////////////
+// counters
+//////////////////////////////////////////////////////////////////////////
+Backpressure::Stats Backpressure::stats()
+{
+    Stats res={0};
+    res.shedding =mShedding.load();
+    res.episodes =mEpisodes.load();
+    res.conflated=mActions[ACTION_CONFLATE].load();
+    res.dropped  =mActions[ACTION_DROP].load();
+    res.coalesced=mActions[ACTION_COALESCE].load();
+    res.blocked  =mBlocked.load();
+    res.spooled  =mActions[ACTION_SPOOL].load();
+    // lock
+    mSync.lock();
+    res.pending=mMargins.size();
+    // unlock
+    mSync.unlock();
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// policy by name
+//////////////////////////////////////////////////////////////////////////
+int Backpressure::policy(const char *name)
+{
+    // checks
+    if(name==nullptr)
+        return(-1);
+    if(_stricmp(name,"pass")==0)     return(POLICY_PASS);
+    if(_stricmp(name,"conflate")==0) return(POLICY_CONFLATE);
+    if(_stricmp(name,"drop")==0)     return(POLICY_DROP);
+    if(_stricmp(name,"coalesce")==0) return(POLICY_COALESCE);
+    if(_stricmp(name,"block")==0)    return(POLICY_BLOCK);
+    if(_stricmp(name,"spool")==0)    return(POLICY_SPOOL);
+    return(-1);
+}
+//////////////////////////////////////////////////////////////////////////
+// hysteresis between watermarks
+//////////////////////////////////////////////////////////////////////////
+bool Backpressure::check(size_t depth)
+{
+    bool shedding=mShedding.load(std::memory_order_relaxed);
+    // start shedding
+    if(!shedding && depth>=mSettings.high)
+    {
+        if(!mShedding.exchange(true))
+        {
+            mEpisodes.fetch_add(1,std::memory_order_relaxed);
+            if(mShedGauge)
+                mShedGauge->set(1);
+            AsyncLogger::get().log("'backpressure': queue depth %u reached high watermark, shedding started",(UINT)depth);
+        }
+        return(true);
+    }
+    // stop shedding
+    if(shedding && depth<=mSettings.low)
+    {
+        if(mShedding.exchange(false))
+        {
+            if(mShedGauge)
+                mShedGauge->set(0);
+            AsyncLogger::get().log("'backpressure': queue depth %u reached low watermark, shedding stopped",(UINT)depth);
+        }
+        return(false);
+    }
+    return(shedding);
+}
+//////////////////////////////////////////////////////////////////////////
+// count shed transaction
+//////////////////////////////////////////////////////////////////////////
+int Backpressure::action(int type,int act)
+{
+    mActions[act].fetch_add(1,std::memory_order_relaxed);
+    if(mShed[act][type])
+        mShed[act][type]->add();
+    return(act);
+}
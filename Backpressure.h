@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////
+// Backpressure.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+#include "Metrics.h"
+
+//////////////////////////////////////////////////////////////////////////
+// type definitions
+//////////////////////////////////////////////////////////////////////////
+typedef std::unordered_map<UINT64,TransMargin> TransMarginCoalesced;
+
+//////////////////////////////////////////////////////////////////////////
+// queue watermarks and load shedding per transaction class
+//////////////////////////////////////////////////////////////////////////
+class Backpressure
+{
+public:
+    // transaction classes
+    enum EnClass
+    {
+        CLASS_QUOTE =0,
+        CLASS_MARGIN=1,
+        CLASS_TRADE =2,
+        CLASS_USER  =3,
+        CLASS_CONFIG=4,             // symbols, groups, symbol groups
+        CLASS_COUNT =5
+    };
+    // policies while queue is above high watermark
+    enum EnPolicy
+    {
+        POLICY_PASS    =0,          // enqueue anyway
+        POLICY_CONFLATE=1,          // hand over to conflator, keep newest per key
+        POLICY_DROP    =2,          // drop transaction
+        POLICY_COALESCE=3,          // keep newest per account until queue drains
+        POLICY_BLOCK   =4,          // wait for queue to drain, quotes and margins are spooled on timeout
+        POLICY_SPOOL   =5           // write to spool instead of queue, quotes and margins only
+    };
+    // admission decisions
+    enum EnAction
+    {
+        ACTION_ENQUEUE =0,
+        ACTION_CONFLATE=1,
+        ACTION_DROP    =2,
+        ACTION_COALESCE=3,
+        ACTION_SPOOL   =4
+    };
+    // settings
+    struct Settings
+    {
+        size_t      high;           // shedding starts at this depth
+        size_t      low;            // shedding stops at this depth
+        UINT        block;          // max wait of blocked quote or margin producer in ms
+        int         policy[CLASS_COUNT];
+    };
+    // counters
+    struct Stats
+    {
+        bool        shedding;
+        UINT64      episodes;       // times high watermark was reached
+        UINT64      conflated;
+        UINT64      dropped;
+        UINT64      coalesced;
+        UINT64      blocked;        // producers that had to wait
+        UINT64      spooled;
+        UINT64      pending;        // coalesced margin levels waiting for drain
+    };
+    // current queue depth
+    typedef std::function<size_t()> DepthFunc;
+    // hand drained margin level over to queue
+    typedef std::function<void(int sid,const TransMargin *trans)> HandoverFunc;
+
+private:
+    // settings
+    Settings        mSettings;
+    DepthFunc       mDepth;
+    // hysteresis state
+    std::atomic<bool> mShedding;
+    // blocked producers
+    std::mutex      mWaitSync;
+    std::condition_variable mWaitCond;
+    // coalesced margin levels by server and login, drains being handed over
+    std::mutex      mSync;
+    TransMarginCoalesced mMargins;
+    std::atomic<int> mDraining;
+    // counters
+    std::atomic<UINT64> mEpisodes;
+    std::atomic<UINT64> mBlocked;
+    std::atomic<UINT64> mActions[ACTION_SPOOL+1];
+    // metrics
+    MetricGauge    *mShedGauge;
+    MetricCounter  *mShed[ACTION_SPOOL+1][CLASS_COUNT];
+
+public:
+    // ctor/dtor
+    Backpressure();
+    ~Backpressure();
+    // init watermarks and policies, depth function reads the guarded queue
+    bool            init(const Settings &settings,DepthFunc depth);
+    // decide what to do with transaction of class, may wait for POLICY_BLOCK
+    int             admit(int type);
+    // margin level is coalesced while older one of its account is pending or being drained
+    int             admit(int sid,const TransMargin *trans);
+    // consumer progress, updates state and wakes blocked producers
+    void            drained();
+    // keep newest margin level per account while shedding
+    void            coalesce(int sid,const TransMargin *trans);
+    // hand coalesced margin levels over once queue is below low watermark
+    size_t          drain(const HandoverFunc &handover);
+    // state
+    bool            shedding() const { return(mShedding.load(std::memory_order_relaxed)); }
+    // counters
+    Stats           stats();
+    // policy by name, -1 if unknown
+    static int      policy(const char *name);
+
+private:
+    // update hysteresis state by depth
+    bool            check(size_t depth);
+    int             action(int type,int act);
+    // spooled or dropped transaction of class would break order of its key for good
+    static bool     ordered(int type) { return(type==CLASS_TRADE || type==CLASS_USER || type==CLASS_CONFIG); }
+    static UINT64   key(int sid,int login) { return(((UINT64)(UINT)sid<<32)|(UINT)login); }
+};
@@ -0,0 +1,212 @@
+//////////////////////////////////////////////////////////////////////////
+// ChangeLog.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "ChangeLog.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+ChangeLog::ChangeLog()
+    : mSegmentSize(0),
+      mKeep(0),
+      mFlushInterval(0),
+      mNext(1),
+      mFlushOffset(0),
+      mFlushTime(std::chrono::steady_clock::now()),
+      mRecords(nullptr),
+      mRolls(nullptr)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+ChangeLog::~ChangeLog()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// open log
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLog::init(const std::string &dir,UINT64 segment,UINT keep,UINT flush)
+{
+    std::vector<UINT64> firsts;
+    // checks
+    if(dir.empty() || segment<sizeof(ChangeLogSegment)+64*1024)
+        return(false);
+    // lock
+    mSync.lock();
+    mDir          =dir;
+    mSegmentSize  =segment;
+    mKeep         =keep<2 ? 2 : keep;
+    mFlushInterval=flush;
+    mRecords      =Metrics::get().counter("replication_changelog_records_total","","Transactions written to change log");
+    mRolls        =Metrics::get().counter("replication_changelog_segments_total","","Change log segments created");
+    // continue last segment
+    CreateDirectoryA(mDir.c_str(),nullptr);
+    ChangeLogSegmentList(mDir,firsts);
+    for(auto it : firsts)
+        mSegments.push_back(ChangeLogSegmentPath(mDir,it));
+    bool res=firsts.empty() ? openSegment(1,true) : openSegment(firsts.back(),false);
+    // unlock
+    mSync.unlock();
+    // log info
+    if(res)
+        Logger::get().log("'%s': change log opened, next sequence %I64u",mDir.c_str(),mNext);
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown
+//////////////////////////////////////////////////////////////////////////
+void ChangeLog::shutdown()
+{
+    // lock
+    mSync.lock();
+    if(mFile.opened())
+    {
+        flushDue(true);
+        mFile.close();
+    }
+    mSegments.clear();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// next sequence number
+//////////////////////////////////////////////////////////////////////////
+UINT64 ChangeLog::next()
+{
+    UINT64 res;
+    // lock
+    mSync.lock();
+    res=mNext;
+    // unlock
+    mSync.unlock();
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// append record under lock
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLog::appendRecord(UINT type,int sid,const void *data,UINT size)
+{
+    FILETIME ft;
+    // checks
+    if(data==nullptr || size==0 || ChangeLogRecordSize(size)>mSegmentSize-sizeof(ChangeLogSegment))
+        return(false);
+    // commit time
+    GetSystemTimeAsFileTime(&ft);
+    INT64 time=(INT64)((((UINT64)ft.dwHighDateTime<<32)|ft.dwLowDateTime)/10-11644473600000000LL);
+    // lock
+    mSync.lock();
+    if(!mFile.opened())
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // segment is full
+    if((UINT64)header()->tail+ChangeLogRecordSize(size)>mFile.size() && !roll())
+    {
+        mSync.unlock();
+        return(false);
+    }
+    ChangeLogSegment *hdr=header();
+    // write record
+    ChangeLogRecord *rec=reinterpret_cast<ChangeLogRecord*>(mFile.data()+hdr->tail);
+    rec->magic=CHANGELOG_RECORD;
+    rec->type =type;
+    rec->size =size;
+    rec->sid  =sid;
+    rec->seq  =mNext++;
+    rec->time =time;
+    memcpy(rec+1,data,size);
+    memset(reinterpret_cast<char*>(rec+1)+size,0,(size_t)(ChangeLogRecordSize(size)-sizeof(ChangeLogRecord)-size));
+    // publish, readers see whole record once tail moves
+    hdr->count++;
+    InterlockedExchange64(&hdr->tail,hdr->tail+(INT64)ChangeLogRecordSize(size));
+    mRecords->add();
+    // periodic flush
+    flushDue(false);
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// open existing or create new segment, called under lock
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLog::openSegment(UINT64 first,bool create)
+{
+    std::string path=ChangeLogSegmentPath(mDir,first);
+    // open file at full size, readers map it once
+    if(!mFile.open(path,mSegmentSize))
+        return(false);
+    ChangeLogSegment *hdr=header();
+    // new or broken segment
+    if(create || hdr->magic!=CHANGELOG_MAGIC || hdr->version!=CHANGELOG_VERSION || hdr->first!=first ||
+       hdr->tail<(INT64)sizeof(ChangeLogSegment) || (UINT64)hdr->tail>mFile.size())
+    {
+        if(!create)
+            Logger::get().log("'%s': invalid change log segment, rewritten",path.c_str());
+        memset(hdr,0,sizeof(ChangeLogSegment));
+        hdr->magic  =CHANGELOG_MAGIC;
+        hdr->version=CHANGELOG_VERSION;
+        hdr->size   =mFile.size();
+        hdr->first  =first;
+        hdr->tail   =sizeof(ChangeLogSegment);
+        mFile.flush(0,sizeof(ChangeLogSegment));
+        if(create)
+        {
+            mSegments.push_back(path);
+            mRolls->add();
+        }
+    }
+    // sealed segment from previous run, continue in next one
+    mNext       =hdr->first+hdr->count;
+    mFlushOffset=hdr->tail;
+    if(hdr->sealed)
+        return(roll());
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// seal current segment and start next one, called under lock
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLog::roll()
+{
+    // seal current
+    if(mFile.opened())
+    {
+        InterlockedExchange(&header()->sealed,1);
+        flushDue(true);
+        mFile.close();
+    }
+    // drop old segments, the ones still mapped by readers are retried on next roll
+    while(mSegments.size()>=mKeep)
+    {
+        if(!DeleteFileA(mSegments.front().c_str()) && GetLastError()!=ERROR_FILE_NOT_FOUND)
+            break;
+        mSegments.pop_front();
+    }
+    // next segment starts with next sequence
+    return(openSegment(mNext,true));
+}
+//////////////////////////////////////////////////////////////////////////
+// flush published records, called under lock
+//////////////////////////////////////////////////////////////////////////
+void ChangeLog::flushDue(bool force)
+{
+    // checks
+    if(!mFile.opened() || (mFlushInterval==0 && !force))
+        return;
+    std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+    if(!force && now-mFlushTime<std::chrono::milliseconds(mFlushInterval))
+        return;
+    // records and header
+    UINT64 tail=(UINT64)header()->tail;
+    if(tail>mFlushOffset)
+        mFile.flush(mFlushOffset,tail-mFlushOffset);
+    mFile.flush(0,sizeof(ChangeLogSegment));
+    mFlushOffset=tail;
+    mFlushTime  =now;
+}
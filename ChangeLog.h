@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////////
+// ChangeLog.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+#include "MappedFile.h"
+#include "ChangeLogFormat.h"
+#include "Metrics.h"
+
+//////////////////////////////////////////////////////////////////////////
+// segmented memory-mapped log of committed transactions
+//////////////////////////////////////////////////////////////////////////
+class ChangeLog
+{
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // settings
+    std::string     mDir;
+    UINT64          mSegmentSize;
+    UINT            mKeep;
+    UINT            mFlushInterval;
+    // current segment
+    MappedFile      mFile;
+    UINT64          mNext;
+    UINT64          mFlushOffset;
+    std::chrono::steady_clock::time_point mFlushTime;
+    // segments on disk, oldest first
+    std::deque<std::string> mSegments;
+    // metrics
+    MetricCounter  *mRecords;
+    MetricCounter  *mRolls;
+
+public:
+    // ctor/dtor
+    ChangeLog();
+    ~ChangeLog();
+    // open log in directory, segment size in bytes, segments to keep, flush interval in ms (0 - leave to OS)
+    bool            init(const std::string &dir,UINT64 segment,UINT keep,UINT flush);
+    void            shutdown();
+    // append data of committed transaction
+    bool            append(int sid,const TransQuote *trans)       { return(appendRecord(CHANGELOG_QUOTE,      sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransTrade *trans)       { return(appendRecord(CHANGELOG_TRADE,      sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransUser *trans)        { return(appendRecord(CHANGELOG_USER,       sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransSymbol *trans)      { return(appendRecord(CHANGELOG_SYMBOL,     sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransGroup *trans)       { return(appendRecord(CHANGELOG_GROUP,      sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransSymbolGroup *trans) { return(appendRecord(CHANGELOG_SYMBOLGROUP,sid,&trans->data,sizeof(trans->data))); }
+    bool            append(int sid,const TransMargin *trans)      { return(appendRecord(CHANGELOG_MARGIN,     sid,&trans->data,sizeof(trans->data))); }
+    // next sequence number
+    UINT64          next();
+
+private:
+    ChangeLogSegment *header() { return(reinterpret_cast<ChangeLogSegment*>(mFile.data())); }
+    bool            appendRecord(UINT type,int sid,const void *data,UINT size);
+    // open existing or create new segment
+    bool            openSegment(UINT64 first,bool create);
+    bool            roll();
+    void            flushDue(bool force);
+};
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////
+// ChangeLogFormat.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// change log file layout shared by writer and readers
+//
+// segment file '<dir>\cdc_<first seq as 16 hex digits>.log' is allocated
+// at full size and starts with ChangeLogSegment, records follow it aligned
+// to 8 bytes, each one is ChangeLogRecord plus data member of Trans* object;
+// writer fills record first and then publishes it by moving segment tail
+//////////////////////////////////////////////////////////////////////////
+#pragma pack(push,8)
+// segment header
+struct ChangeLogSegment
+{
+    UINT            magic;
+    UINT            version;
+    UINT64          size;           // segment file size
+    UINT64          first;          // sequence of first record
+    volatile INT64  count;          // published records
+    volatile INT64  tail;           // end of published records
+    volatile LONG   sealed;         // writer moved to next segment
+    UINT            reserved;
+};
+// record header, payload follows
+struct ChangeLogRecord
+{
+    UINT            magic;
+    UINT            type;           // EnChangeLogType
+    UINT            size;           // payload size
+    int             sid;            // server id
+    UINT64          seq;            // global sequence
+    INT64           time;           // commit time, microseconds since 1970
+};
+#pragma pack(pop)
+
+//////////////////////////////////////////////////////////////////////////
+// constants
+//////////////////////////////////////////////////////////////////////////
+enum EnChangeLogConstants
+{
+    CHANGELOG_MAGIC  =0x43444353,   // 'SCDC'
+    CHANGELOG_RECORD =0x44524343,   // 'CCRD'
+    CHANGELOG_VERSION=2
+};
+// payload types
+enum EnChangeLogType
+{
+    CHANGELOG_QUOTE      =1,        // TransQuote
+    CHANGELOG_TRADE      =2,        // TransTrade
+    CHANGELOG_USER       =3,        // TransUser
+    CHANGELOG_SYMBOL     =4,        // TransSymbol
+    CHANGELOG_GROUP      =5,        // TransGroup
+    CHANGELOG_SYMBOLGROUP=6,        // TransSymbolGroup
+    CHANGELOG_MARGIN     =7         // TransMargin
+};
+// record size with padding
+inline UINT64 ChangeLogRecordSize(UINT size) { return(sizeof(ChangeLogRecord)+((size+7)&~7u)); }
+// segment file name
+inline std::string ChangeLogSegmentPath(const std::string &dir,UINT64 first)
+{
+    char name[64];
+    _snprintf_s(name,_countof(name),_TRUNCATE,"\\cdc_%016I64x.log",first);
+    return(dir+name);
+}
+// existing segments sorted by first sequence
+inline void ChangeLogSegmentList(const std::string &dir,std::vector<UINT64> &firsts)
+{
+    WIN32_FIND_DATAA data;
+    UINT64           first;
+    firsts.clear();
+    // find files
+    HANDLE find=FindFirstFileA((dir+"\\cdc_*.log").c_str(),&data);
+    if(find==INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        if(sscanf_s(data.cFileName,"cdc_%16I64x.log",&first)==1)
+            firsts.push_back(first);
+    } while(FindNextFileA(find,&data));
+    FindClose(find);
+    // oldest first
+    std::sort(firsts.begin(),firsts.end());
+}
@@ -0,0 +1,181 @@
+//////////////////////////////////////////////////////////////////////////
+// ChangeLogReader.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "ChangeLogReader.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+ChangeLogReader::ChangeLogReader()
+    : mOffset(0),
+      mNext(0),
+      mGap(false)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+ChangeLogReader::~ChangeLogReader()
+{
+    close();
+}
+//////////////////////////////////////////////////////////////////////////
+// start reading
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLogReader::open(const std::string &dir,UINT64 seq)
+{
+    // checks
+    if(dir.empty())
+        return(false);
+    close();
+    mDir=dir;
+    mGap=false;
+    // oldest available
+    if(seq==0)
+    {
+        std::vector<UINT64> firsts;
+        ChangeLogSegmentList(mDir,firsts);
+        if(firsts.empty())
+            return(false);
+        seq=firsts.front();
+    }
+    return(openSegment(seq));
+}
+//////////////////////////////////////////////////////////////////////////
+// close
+//////////////////////////////////////////////////////////////////////////
+void ChangeLogReader::close()
+{
+    mFile.close();
+    mOffset=0;
+}
+//////////////////////////////////////////////////////////////////////////
+// map segment containing sequence and skip to it
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLogReader::openSegment(UINT64 seq)
+{
+    std::vector<UINT64> firsts;
+    UINT64              first=0;
+    // newest segment starting at or before sequence
+    ChangeLogSegmentList(mDir,firsts);
+    for(auto it : firsts)
+        if(it<=seq)
+            first=it;
+    // sequence is older than every segment, removed by retention
+    if(first==0 && !firsts.empty() && !mGap)
+    {
+        mGap=true;
+        Logger::get().log("'%s': change log records %I64u-%I64u were removed by retention, reader has to reopen",mDir.c_str(),seq,firsts.front()-1);
+    }
+    if(first==0)
+        return(false);
+    // map read-only
+    mFile.close();
+    if(!mFile.open(ChangeLogSegmentPath(mDir,first),0,true))
+        return(false);
+    const ChangeLogSegment *hdr=header();
+    if(mFile.size()<sizeof(ChangeLogSegment) || hdr->magic!=CHANGELOG_MAGIC || hdr->version!=CHANGELOG_VERSION || hdr->size!=mFile.size())
+    {
+        mFile.close();
+        return(false);
+    }
+    // skip records before sequence
+    mOffset=sizeof(ChangeLogSegment);
+    mNext  =hdr->first;
+    while(mNext<seq)
+    {
+        UINT64 tail=(UINT64)InterlockedCompareExchange64(const_cast<volatile INT64*>(&hdr->tail),0,0);
+        if(mOffset>=tail)
+            break;
+        const ChangeLogRecord *rec=reinterpret_cast<const ChangeLogRecord*>(mFile.data()+mOffset);
+        mOffset+=ChangeLogRecordSize(rec->size);
+        mNext   =rec->seq+1;
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// next published record
+//////////////////////////////////////////////////////////////////////////
+const ChangeLogRecord *ChangeLogReader::next()
+{
+    const ChangeLogRecord *rec;
+    // checks
+    if(!mFile.opened() && (mDir.empty() || !openSegment(mNext)))
+        return(nullptr);
+    // sealed flag is read before tail, so sealed segment has nothing more to publish
+    bool sealed=InterlockedCompareExchange(const_cast<volatile LONG*>(&header()->sealed),0,0)!=0;
+    if((rec=read())!=nullptr)
+        return(rec);
+    // move to next segment once writer created it
+    if(sealed && advance())
+        return(read());
+    // nothing new
+    return(nullptr);
+}
+//////////////////////////////////////////////////////////////////////////
+// published record at current offset
+//////////////////////////////////////////////////////////////////////////
+const ChangeLogRecord *ChangeLogReader::read()
+{
+    const ChangeLogSegment *hdr=header();
+    UINT64 tail=(UINT64)InterlockedCompareExchange64(const_cast<volatile INT64*>(&hdr->tail),0,0);
+    // checks
+    if(mOffset>=tail)
+        return(nullptr);
+    const ChangeLogRecord *rec=reinterpret_cast<const ChangeLogRecord*>(mFile.data()+mOffset);
+    // broken record, stop here
+    if(rec->magic!=CHANGELOG_RECORD || mOffset+ChangeLogRecordSize(rec->size)>tail)
+        return(nullptr);
+    mOffset+=ChangeLogRecordSize(rec->size);
+    mNext   =rec->seq+1;
+    return(rec);
+}
+//////////////////////////////////////////////////////////////////////////
+// map segment starting at next sequence, current one stays mapped until it exists
+//////////////////////////////////////////////////////////////////////////
+bool ChangeLogReader::advance()
+{
+    std::vector<UINT64> firsts;
+    bool                found=false;
+    // next segment
+    ChangeLogSegmentList(mDir,firsts);
+    for(auto it : firsts)
+        if(it==mNext)
+            found=true;
+    if(!found)
+    {
+        // newer segments without ours, records were removed
+        if(!firsts.empty() && firsts.back()>mNext && !mGap)
+        {
+            mGap=true;
+            Logger::get().log("'%s': change log segment starting at %I64u is missing, reader has to reopen",mDir.c_str(),mNext);
+        }
+        return(false);
+    }
+    // switch
+    mFile.close();
+    return(openSegment(mNext));
+}
+//////////////////////////////////////////////////////////////////////////
+// wait for next record
+//////////////////////////////////////////////////////////////////////////
+const ChangeLogRecord *ChangeLogReader::next(UINT timeout)
+{
+    std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(timeout);
+    const ChangeLogRecord *rec;
+    UINT                   wait=POLL_MIN;
+    // poll published tail, idle writer or missing next segment doubles the pause
+    while((rec=next())==nullptr)
+    {
+        std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+        if(now>=deadline)
+            break;
+        UINT left=(UINT)std::chrono::duration_cast<std::chrono::milliseconds>(deadline-now).count()+1;
+        Sleep(wait<left ? wait : left);
+        wait=wait*2<POLL_MAX ? wait*2 : POLL_MAX;
+    }
+    return(rec);
+}
@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////
+// ChangeLogReader.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "MappedFile.h"
+#include "ChangeLogFormat.h"
+
+//////////////////////////////////////////////////////////////////////////
+// zero-copy tail reader of change log for local consumers
+//////////////////////////////////////////////////////////////////////////
+class ChangeLogReader
+{
+private:
+    // constants
+    enum constants
+    {
+        POLL_MIN=1,                     // ms, first pause of waiting reader
+        POLL_MAX=64                     // ms, longest pause of waiting reader
+    };
+
+private:
+    // log directory
+    std::string     mDir;
+    // current segment mapped read-only
+    MappedFile      mFile;
+    UINT64          mOffset;
+    // sequence of next record
+    UINT64          mNext;
+    // records before available segments were removed by retention
+    bool            mGap;
+
+public:
+    // ctor/dtor
+    ChangeLogReader();
+    ~ChangeLogReader();
+    // start reading at sequence, 0 - oldest available record
+    bool            open(const std::string &dir,UINT64 seq=0);
+    void            close();
+    // next published record or nullptr if there is none yet,
+    // record points into mapped segment and is valid until the following call
+    const ChangeLogRecord *next();
+    // wait up to timeout ms for next record
+    const ChangeLogRecord *next(UINT timeout);
+    // sequence of next record
+    UINT64          position() const { return(mNext); }
+    // reader fell behind retention, reopen to continue from oldest available record
+    bool            gap() const      { return(mGap); }
+    // payload of record as data of transaction type T
+    template<class T>
+    static const decltype(T::data) *payload(const ChangeLogRecord *rec) { return(rec && rec->size==sizeof(T::data) ? reinterpret_cast<const decltype(T::data)*>(rec+1) : nullptr); }
+
+private:
+    const ChangeLogSegment *header() { return(reinterpret_cast<const ChangeLogSegment*>(mFile.data())); }
+    // map segment containing sequence
+    bool            openSegment(UINT64 seq);
+    // record at offset of current segment
+    const ChangeLogRecord *read();
+    // map segment following sealed one once it exists
+    bool            advance();
+};
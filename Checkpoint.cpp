@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////////////////////////
+// Checkpoint.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Checkpoint.h"
+#include <fstream>
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+Checkpoint::Checkpoint()
+    : mLoaded(false)
+{
+    memset(&mState,0,sizeof(mState));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+Checkpoint::~Checkpoint()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// load checkpoint
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint::init(const std::string &workpath,int sid)
+{
+    std::ifstream f;
+    State         state;
+    // lock
+    mSync.lock();
+    // file name
+    std::ostringstream path;
+    path << workpath << "\\checkpoint_" << sid << ".dat";
+    mPath  =path.str();
+    mLoaded=false;
+    memset(&mState,0,sizeof(mState));
+    mState.sid=sid;
+    // read file
+    f.open(mPath,std::ios::in|std::ios::binary);
+    if(!f.fail())
+    {
+        f.read(reinterpret_cast<char*>(&state),sizeof(state));
+        // validate
+        if(f.gcount()==sizeof(state) && state.magic==CHECKPOINT_MAGIC && state.version==CHECKPOINT_VERSION &&
+           state.sid==sid && state.checksum==checksum(state))
+        {
+            mState =state;
+            mLoaded=true;
+        }
+        else
+            Logger::get().log("server #%d: invalid checkpoint '%s' ignored",sid,mPath.c_str());
+        f.close();
+    }
+    // unlock
+    mSync.unlock();
+    // result
+    return(mLoaded);
+}
+//////////////////////////////////////////////////////////////////////////
+// checkpoint can be used for incremental resync
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint::valid(UINT config,__int64 maxage)
+{
+    bool res;
+    // lock
+    mSync.lock();
+    // loaded, same config and fresh enough
+    res=mLoaded && mState.config==config && (maxage<=0 || _time64(nullptr)-mState.saved<=maxage);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// forget checkpoint
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint::reset(UINT config)
+{
+    // lock
+    mSync.lock();
+    int sid=mState.sid;
+    memset(&mState,0,sizeof(mState));
+    mState.sid   =sid;
+    mState.config=config;
+    mLoaded      =false;
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// record committed rows
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint::update(const TradeRecord *record)
+{
+    // checks
+    if(record==nullptr)
+        return;
+    // lock
+    mSync.lock();
+    if(record->order>mState.last_ticket)
+        mState.last_ticket=record->order;
+    if(record->timestamp>mState.last_trade)
+        mState.last_trade=record->timestamp;
+    // unlock
+    mSync.unlock();
+}
+void Checkpoint::update(const UserRecord *record)
+{
+    // checks
+    if(record==nullptr)
+        return;
+    // lock
+    mSync.lock();
+    if(record->timestamp>mState.last_user)
+        mState.last_user=record->timestamp;
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// record changed since checkpoint
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint::changed(const TradeRecord *record,__int64 overlap)
+{
+    bool res;
+    // checks
+    if(record==nullptr)
+        return(false);
+    // lock
+    mSync.lock();
+    // new ticket or modified after checkpoint
+    res=!mLoaded || record->order>mState.last_ticket || record->timestamp>=mState.last_trade-overlap;
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+bool Checkpoint::changed(const UserRecord *record,__int64 overlap)
+{
+    bool res;
+    // checks
+    if(record==nullptr)
+        return(false);
+    // lock
+    mSync.lock();
+    res=!mLoaded || record->timestamp>=mState.last_user-overlap;
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// persist, temporary file replaces old one atomically
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint::save()
+{
+    std::ofstream f;
+    State         state;
+    // lock
+    mSync.lock();
+    // checks
+    if(mPath.empty())
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // stamp state
+    mState.magic   =CHECKPOINT_MAGIC;
+    mState.version =CHECKPOINT_VERSION;
+    mState.saved   =_time64(nullptr);
+    mState.checksum=checksum(mState);
+    state          =mState;
+    std::string tmp=mPath+".tmp";
+    // unlock
+    mSync.unlock();
+    // write temporary file
+    f.open(tmp,std::ios::out|std::ios::trunc|std::ios::binary);
+    if(f.fail())
+        return(false);
+    f.write(reinterpret_cast<const char*>(&state),sizeof(state));
+    f.close();
+    if(f.fail())
+        return(false);
+    // replace
+    if(!MoveFileExA(tmp.c_str(),mPath.c_str(),MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH))
+    {
+        Logger::get().log("server #%d: failed to save checkpoint '%s' [%u]",state.sid,mPath.c_str(),GetLastError());
+        return(false);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// FNV-1a checksum of state without checksum field
+//////////////////////////////////////////////////////////////////////////
+UINT Checkpoint::checksum(const State &state)
+{
+    const unsigned char *ptr=reinterpret_cast<const unsigned char*>(&state);
+    UINT res=2166136261u;
+    for(size_t i=0;i<offsetof(State,checksum);i++)
+    {
+        res^=ptr[i];
+        res*=16777619u;
+    }
+    return(res);
+}
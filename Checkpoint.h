@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////
+// Checkpoint.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// per-server replication checkpoint for incremental resync
+//////////////////////////////////////////////////////////////////////////
+class Checkpoint
+{
+private:
+    // persisted state
+    struct State
+    {
+        UINT            magic;
+        UINT            version;
+        int             sid;
+        int             last_ticket;        // max trade ticket committed
+        __int64         last_trade;         // max trade modification time
+        __int64         last_user;          // max user modification time
+        UINT            config;             // config revision
+        UINT            reserved;
+        __int64         saved;              // save time
+        UINT            checksum;
+    };
+    // constants
+    enum constants
+    {
+        CHECKPOINT_MAGIC  =0x54504B43,      // 'CKPT'
+        CHECKPOINT_VERSION=1
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // file name
+    std::string     mPath;
+    // current and loaded state
+    State           mState;
+    bool            mLoaded;
+
+public:
+    // ctor/dtor
+    Checkpoint();
+    ~Checkpoint();
+    // load checkpoint of server from work dir
+    bool            init(const std::string &workpath,int sid);
+    // checkpoint can be used for incremental resync
+    bool            valid(UINT config,__int64 maxage);
+    // forget checkpoint, next resync is full
+    void            reset(UINT config);
+    // record committed rows
+    void            update(const TradeRecord *record);
+    void            update(const UserRecord *record);
+    // record changed since checkpoint, overlap covers clock skew between server and checkpoint
+    bool            changed(const TradeRecord *record,__int64 overlap);
+    bool            changed(const UserRecord *record,__int64 overlap);
+    // persist
+    bool            save();
+
+private:
+    static UINT     checksum(const State &state);
+};
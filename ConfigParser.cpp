@@ -16,29 +16,38 @@ ConfigParser::ConfigParser()
 // dtor
 //////////////////////////////////////////////////////////////////////////
 ConfigParser::~ConfigParser()
+{
+    clear();
+}
+//////////////////////////////////////////////////////////////////////////
+// drop parsed content
+//////////////////////////////////////////////////////////////////////////
+void ConfigParser::clear()
 {
     // delete vector
     for(auto it : mConf)
         delete(it);
+    mConf.clear();
+    mIndex.clear();
 }
 //////////////////////////////////////////////////////////////////////////
 // parse file
 //////////////////////////////////////////////////////////////////////////
 bool ConfigParser::init(std::string filename)
 {
-    Section      *sec;
+    Section      *sec=nullptr;
     std::ifstream f;
+    std::string   buf;
+    // drop previous content
+    clear();
     // open file
     f.open(filename);
     // check
     if(f.fail())
         return(false);
-    // read file
-    while(!f.eof())
+    // read file, lines of any length
+    while(std::getline(f,buf))
     {
-        char buf[255];
-        // get next line
-        f.getline(buf,_countof(buf));
         std::string line(Tools::trimStr(buf));
         // skip blank lines
         if(line.empty())
@@ -56,13 +65,20 @@ bool ConfigParser::init(std::string filename)
             mConf.push_back(new Section());
             sec         =mConf[mConf.size()-1];
             sec->section=Tools::trimStr(line.substr(1,end-1));
+            mIndex[sec->section].push_back(mConf.size()-1);
             continue;
         }
-        // found property
+        // property outside of section or without value
         std::string::size_type eqpos=line.find('=');
+        if(sec==nullptr || eqpos==std::string::npos)
+            continue;
+        // found property
         Property prop;
         prop.key  =Tools::trimStr(line.substr(0,eqpos));
         prop.value=Tools::trimStr(line.substr(eqpos+1,line.length()));
+        // first value of repeated key wins
+        if(sec->index.find(prop.key)==sec->index.end())
+            sec->index[prop.key]=sec->properties.size();
         sec->properties.push_back(prop);
     }
     // close file
@@ -70,3 +86,57 @@ bool ConfigParser::init(std::string filename)
     // success
     return(true);
 }
+//////////////////////////////////////////////////////////////////////////
+// first section by name
+//////////////////////////////////////////////////////////////////////////
+const ConfigParser::Section *ConfigParser::sectionFind(const std::string &name) const
+{
+    std::unordered_map<std::string,std::vector<size_t>>::const_iterator it=mIndex.find(name);
+    // checks
+    if(it==mIndex.end() || it->second.empty())
+        return(nullptr);
+    return(mConf[it->second[0]]);
+}
+//////////////////////////////////////////////////////////////////////////
+// all sections by name
+//////////////////////////////////////////////////////////////////////////
+size_t ConfigParser::sectionFind(const std::string &name,SectionList &sections) const
+{
+    std::unordered_map<std::string,std::vector<size_t>>::const_iterator it=mIndex.find(name);
+    sections.clear();
+    // checks
+    if(it==mIndex.end())
+        return(0);
+    for(auto pos : it->second)
+        sections.push_back(mConf[pos]);
+    return(sections.size());
+}
+//////////////////////////////////////////////////////////////////////////
+// sections added and removed between configs
+//////////////////////////////////////////////////////////////////////////
+void ConfigParser::diff(const ConfigParser &prev,const ConfigParser &cur,SectionList &added,SectionList &removed)
+{
+    std::vector<bool> matched(prev.mConf.size(),false);
+    added.clear();
+    removed.clear();
+    // match sections of current config with identical previous ones
+    for(auto sec : cur.mConf)
+    {
+        bool found=false;
+        std::unordered_map<std::string,std::vector<size_t>>::const_iterator it=prev.mIndex.find(sec->section);
+        if(it!=prev.mIndex.end())
+            for(auto pos : it->second)
+                if(!matched[pos] && prev.mConf[pos]->equal(*sec))
+                {
+                    matched[pos]=true;
+                    found=true;
+                    break;
+                }
+        if(!found)
+            added.push_back(sec);
+    }
+    // previous sections without pair
+    for(size_t i=0;i<prev.mConf.size();i++)
+        if(!matched[i])
+            removed.push_back(prev.mConf[i]);
+}
@@ -21,19 +21,49 @@ public:
     {
         std::string section;
         std::vector<Property> properties;
+        // property position by key
+        std::unordered_map<std::string,size_t> index;
+        // property value by key, nullptr if absent
+        const std::string *get(const std::string &key) const
+        {
+            std::unordered_map<std::string,size_t>::const_iterator it=index.find(key);
+            return(it!=index.end() ? &properties[it->second].value : nullptr);
+        }
+        // same name and properties
+        bool equal(const Section &other) const
+        {
+            if(section!=other.section || properties.size()!=other.properties.size())
+                return(false);
+            for(size_t i=0;i<properties.size();i++)
+                if(properties[i].key!=other.properties[i].key || properties[i].value!=other.properties[i].value)
+                    return(false);
+            return(true);
+        }
     };
+    // sections list
+    typedef std::vector<const Section*> SectionList;
 
 private:
     // list of sections with children
     std::vector<Section *> mConf;
+    // section positions by name, repeated sections keep file order
+    std::unordered_map<std::string,std::vector<size_t>> mIndex;
 
 public:
     // ctor/dtor
     ConfigParser();
     ~ConfigParser();
-    // init and parse
+    // init and parse, previous content is dropped
     bool    init(std::string filename);
+    void    clear();
     // access config
-    size_t  sectionCount()              { return(mConf.size());  }
-    const Section *sectionGet(int pos)  { return(mConf.at(pos)); }
+    size_t  sectionCount() const             { return(mConf.size());  }
+    const Section *sectionGet(int pos) const { return(mConf.at(pos)); }
+    // first section by name, nullptr if absent
+    const Section *sectionFind(const std::string &name) const;
+    // all sections by name
+    size_t  sectionFind(const std::string &name,SectionList &sections) const;
+    // sections of current config missing in previous one and vice versa,
+    // changed section shows up in both lists
+    static void diff(const ConfigParser &prev,const ConfigParser &cur,SectionList &added,SectionList &removed);
 };
@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////
+// ConfigWatcher.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "ConfigWatcher.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+ConfigWatcher::ConfigWatcher()
+    : mInterval(0),
+      mThread(nullptr),
+      mStop(false),
+      mRequest(false),
+      mReloads(0)
+{
+    memset(&mState,  0,sizeof(mState));
+    memset(&mPending,0,sizeof(mPending));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+ConfigWatcher::~ConfigWatcher()
+{
+    // finalize work
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// start watching
+//////////////////////////////////////////////////////////////////////////
+bool ConfigWatcher::init(const std::string &file,UINT interval,ReloadFunc func)
+{
+    // checks
+    if(mThread || file.empty() || interval==0 || !func)
+        return(false);
+    // copy params
+    mFile    =file;
+    mInterval=interval;
+    mFunc    =func;
+    // parse running config to diff against
+    mState=fileState();
+    memset(&mPending,0,sizeof(mPending));
+    mConfig.reset(new ConfigParser());
+    if(!mConfig->init(mFile))
+    {
+        Logger::get().log("'%s': failed to parse config for reload",mFile.c_str());
+        mConfig.reset();
+        return(false);
+    }
+    // start thread
+    mStop.store(false);
+    mThread=new std::thread(&ConfigWatcher::funcWrapWatch,this);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown
+//////////////////////////////////////////////////////////////////////////
+void ConfigWatcher::shutdown()
+{
+    // checks
+    if(mThread==nullptr)
+        return;
+    // wake and wait watcher
+    mStop.store(true);
+    mWaitSync.lock();
+    mWaitCond.notify_all();
+    mWaitSync.unlock();
+    mThread->join();
+    delete(mThread);
+    mThread=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// reload at once
+//////////////////////////////////////////////////////////////////////////
+void ConfigWatcher::trigger()
+{
+    mRequest.store(true);
+    mWaitSync.lock();
+    mWaitCond.notify_all();
+    mWaitSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// write time and size of file
+//////////////////////////////////////////////////////////////////////////
+ConfigWatcher::FileState ConfigWatcher::fileState() const
+{
+    WIN32_FILE_ATTRIBUTE_DATA data={0};
+    FileState                 res ={0};
+    // checks
+    if(!GetFileAttributesExA(mFile.c_str(),GetFileExInfoStandard,&data))
+        return(res);
+    res.time=((UINT64)data.ftLastWriteTime.dwHighDateTime<<32)|data.ftLastWriteTime.dwLowDateTime;
+    res.size=((UINT64)data.nFileSizeHigh<<32)|data.nFileSizeLow;
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// parse and apply
+//////////////////////////////////////////////////////////////////////////
+bool ConfigWatcher::reload()
+{
+    ConfigParser::SectionList added,removed;
+    std::unique_ptr<ConfigParser> config(new ConfigParser());
+    // parse new config, broken file keeps running config
+    if(!config->init(mFile))
+    {
+        Logger::get().log("'%s': failed to parse changed config, running config is kept",mFile.c_str());
+        return(false);
+    }
+    // diff
+    ConfigParser::diff(*mConfig,*config,added,removed);
+    if(added.empty() && removed.empty())
+        return(true);
+    Logger::get().log("'%s': config changed, %u sections added, %u sections removed",mFile.c_str(),(UINT)added.size(),(UINT)removed.size());
+    // apply, old sections stay valid during callback
+    mFunc(*mConfig,*config,added,removed);
+    mConfig.swap(config);
+    mReloads.fetch_add(1);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// watcher thread
+//////////////////////////////////////////////////////////////////////////
+void ConfigWatcher::funcWrapWatch(void *param)
+{
+    if(param)
+        static_cast<ConfigWatcher*>(param)->runWatch();
+}
+//////////////////////////////////////////////////////////////////////////
+// check file write time and reload requests
+//////////////////////////////////////////////////////////////////////////
+void ConfigWatcher::runWatch()
+{
+    while(!mStop.load())
+    {
+        // wait for interval or request
+        {
+            std::unique_lock<std::mutex> lock(mWaitSync);
+            mWaitCond.wait_for(lock,std::chrono::milliseconds(mInterval),[this]() { return(mStop.load() || mRequest.load()); });
+        }
+        if(mStop.load())
+            break;
+        // file changed or reload requested
+        FileState state=fileState();
+        if(!mRequest.exchange(false))
+        {
+            // not changed
+            if(state.time==0 || (state.time==mState.time && state.size==mState.size))
+            {
+                memset(&mPending,0,sizeof(mPending));
+                continue;
+            }
+            // still being written, partial file would tear down running managers and databases
+            if(state.time!=mPending.time || state.size!=mPending.size)
+            {
+                mPending=state;
+                continue;
+            }
+        }
+        mState=state;
+        memset(&mPending,0,sizeof(mPending));
+        reload();
+    }
+}
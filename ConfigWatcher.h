@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////
+// ConfigWatcher.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "ConfigParser.h"
+
+//////////////////////////////////////////////////////////////////////////
+// reloads configuration file on change or on request
+//////////////////////////////////////////////////////////////////////////
+class ConfigWatcher
+{
+public:
+    // reload callback with previous and new config, sections are diffed by caller
+    typedef std::function<void(const ConfigParser &prev,const ConfigParser &cur,
+                               const ConfigParser::SectionList &added,
+                               const ConfigParser::SectionList &removed)> ReloadFunc;
+
+private:
+    // file write time and size, 0 time if not accessible
+    struct FileState
+    {
+        UINT64          time;
+        UINT64          size;
+    };
+
+private:
+    // settings
+    std::string     mFile;
+    UINT            mInterval;
+    ReloadFunc      mFunc;
+    // running config
+    std::unique_ptr<ConfigParser> mConfig;
+    FileState       mState;
+    // changed state seen on last check, reloaded only once it is stable
+    FileState       mPending;
+    // watcher thread
+    std::thread    *mThread;
+    std::atomic<bool> mStop;
+    std::atomic<bool> mRequest;
+    std::mutex      mWaitSync;
+    std::condition_variable mWaitCond;
+    // counters
+    std::atomic<UINT64> mReloads;
+
+public:
+    // ctor/dtor
+    ConfigWatcher();
+    ~ConfigWatcher();
+    // start watching, file is checked every interval ms and reloaded
+    // once its write time and size are equal on two checks in a row
+    bool            init(const std::string &file,UINT interval,ReloadFunc func);
+    void            shutdown();
+    // reload at once, e.g. from console control or signal handler
+    void            trigger();
+    // successful reloads
+    UINT64          reloads() const { return(mReloads.load()); }
+
+private:
+    // current write time and size of file
+    FileState       fileState() const;
+    // parse and apply
+    bool            reload();
+    // watcher thread
+    static void     funcWrapWatch(void *param);
+    void            runWatch();
+};
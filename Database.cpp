@@ -4,19 +4,34 @@
 //////////////////////////////////////////////////////////////////////////
 #include "stdafx.h"
 #include "Database.h"
+#include "TransKey.h"
+#include "TransAllocator.h"
+#include "MySQLSession.h"
+#include "SQLiteSession.h"
+#include "FileSession.h"
+#include "ThreadPlacement.h"
 
 //////////////////////////////////////////////////////////////////////////
 // ctor
 //////////////////////////////////////////////////////////////////////////
 Database::Database()
-    : mProcPriceUpdate(nullptr),
-      mProcUserUpdate(nullptr),
-      mProcTradeUpdate(nullptr),
-      mProcSymbolUpdate(nullptr),
-      mProcGroupUpdate(nullptr),
-      mProcSymbolGroupUpdate(nullptr),
-      mProcMarginUpdate(nullptr)
+    : mBackend(BACKEND_MYSQL),
+      mClosing(false),
+      mActive(0),
+      mMonitor(nullptr),
+      mStop(false),
+      mInterval(0),
+      mBackoffMin(0),
+      mBackoffMax(0),
+      mChangeLog(nullptr),
+      mReconnects(nullptr),
+      mUp(nullptr)
 {
+    memset(mLatency,     0,sizeof(mLatency));
+    memset(mBatchLatency,0,sizeof(mBatchLatency));
+    memset(mCommitted,   0,sizeof(mCommitted));
+    memset(mFailed,      0,sizeof(mFailed));
+    memset(mSpooled,     0,sizeof(mSpooled));
 }
 //////////////////////////////////////////////////////////////////////////
 // dtor
@@ -29,7 +44,7 @@ Database::~Database()
 //////////////////////////////////////////////////////////////////////////
 // initialization
 //////////////////////////////////////////////////////////////////////////
-bool Database::init(char *host,char *port,char *user,char *pass,char *schema)
+bool Database::init(char *host,char *port,char *user,char *pass,char *schema,int pool,int backend)
 {
     // checks
     if(host==nullptr || port==nullptr || user==nullptr || pass==nullptr || schema==nullptr)
@@ -37,6 +52,11 @@ bool Database::init(char *host,char *port,char *user,char *pass,char *schema)
         Logger::get().log("failed to initialize '%s' database [invalid connection details]",schema);
         return(false);
     }
+    if(pool<1)
+        pool=1;
+    // embedded backends have a single writer
+    if(backend!=BACKEND_MYSQL)
+        pool=1;
     // lock
     mSync.lock();
     // copy params
@@ -45,10 +65,35 @@ bool Database::init(char *host,char *port,char *user,char *pass,char *schema)
     mUser=user;
     mPass=pass;
     mSrvc=schema;
-    // format connection string
-    std::ostringstream conn;
-    conn << "mysql://host=" << mHost.c_str() << " port=" << mPort << " dbname=" << mSrvc << " user=" << mUser << " password='" << mPass << "'";
-    mConn=conn.str();
+    mBackend=backend;
+    // format connection string, embedded backends take file path from host
+    if(backend==BACKEND_MYSQL)
+    {
+        std::ostringstream conn;
+        conn << "mysql://host=" << mHost.c_str() << " port=" << mPort << " dbname=" << mSrvc << " user=" << mUser << " password='" << mPass << "'";
+        mConn=conn.str();
+    }
+    else
+        mConn=mHost;
+    // sessions pool slots, sessions are opened on connect
+    mClosing.store(false);
+    mSessions.resize(pool);
+    mHealthy.reset(new std::atomic<bool>[pool]);
+    for(int i=0;i<pool;i++)
+        mHealthy[i].store(false);
+    // register metrics
+    static const char *types[COMMIT_TYPES]={ "","quote","trade","user","symbol","group","symbolgroup","margin" };
+    for(int i=COMMIT_QUOTE;i<COMMIT_TYPES;i++)
+    {
+        std::string labels="db=\""+mSrvc+"\",type=\""+types[i]+"\"";
+        mLatency[i]     =Metrics::get().histogram("replication_commit_latency_us",labels,"Single row commit latency in microseconds");
+        mBatchLatency[i]=Metrics::get().histogram("replication_batch_latency_us",labels,"Batch commit latency in microseconds");
+        mCommitted[i]   =Metrics::get().counter("replication_committed_total",labels,"Rows committed");
+        mFailed[i]      =Metrics::get().counter("replication_failed_total",labels,"Rows failed to commit");
+        mSpooled[i]     =Metrics::get().counter("replication_spooled_total",labels,"Rows spooled while database was unreachable");
+    }
+    mReconnects=Metrics::get().counter("replication_reconnects_total","db=\""+mSrvc+"\"","Database session reconnects");
+    mUp        =Metrics::get().gauge("replication_db_up","db=\""+mSrvc+"\"","1 while all database sessions are connected");
     // unlock
     mSync.unlock();
     // connect immediately
@@ -57,435 +102,663 @@ bool Database::init(char *host,char *port,char *user,char *pass,char *schema)
     return(true);
 }
 //////////////////////////////////////////////////////////////////////////
-// connect to db
+// backend by config name
 //////////////////////////////////////////////////////////////////////////
-bool Database::connect()
+int Database::backend(const char *name)
 {
-    // lock
-    mSync.lock();
-    // disconnect first
-    disconnect();
-    // create session
-    try
-    {
-        // open db connection
-        mSQL.open(mConn);
-        // prepare stored proc-s
-        prepare();
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to create mysql session [%s]",mSrvc.c_str(),e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to create sql session [%s]",mSrvc.c_str(),e.what());
-        mSync.unlock();
-        return(false);
-    }
-    // unlock
-    mSync.unlock();
-    // log info
-    Logger::get().log("'%s': connected to '%s@%s' database",mUser.c_str(),mSrvc.c_str(),mHost.c_str());
-    // success
-    return(true);
+    // checks
+    if(name==nullptr || name[0]==0)
+        return(BACKEND_MYSQL);
+    // known names
+    if(_stricmp(name,"sqlite")==0)
+        return(BACKEND_SQLITE);
+    if(_stricmp(name,"file")==0)
+        return(BACKEND_FILE);
+    if(_stricmp(name,"mysql")!=0)
+        Logger::get().log("unknown database backend '%s', mysql is used",name);
+    // default
+    return(BACKEND_MYSQL);
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// open spool, transactions left from previous run are replayed on connect
 //////////////////////////////////////////////////////////////////////////
-bool Database::connected()
+bool Database::initSpool(const std::string &path,UINT flush)
 {
-    int res=0;
-    // lock
-    mSync.lock();
-    // get mysql back-end
-    soci::mysql_session_backend *session=static_cast<soci::mysql_session_backend*>(mSQL.get_backend());
-    if(session==nullptr)
-    {
-        mSync.unlock();
-        return(false);
-    }
-    // ping mysql
-    res=mysql_ping(session->conn_);
-    // unlock
-    mSync.unlock();
-    // check mysql state
-    if(res)
+    // open file
+    if(!mSpool.init(path,flush))
     {
-        Logger::get().log("'%s': connection to mysql server has been lost, reconnecting.. [%d]",mSrvc.c_str(),res);
+        Logger::get().log("'%s': failed to open spool '%s'",mSrvc.c_str(),path.c_str());
         return(false);
     }
-    // connected
+    // replay recovered transactions
+    if(mSpool.active() && connected())
+        mSpool.replay([this](UINT type,const void *data,UINT size) { return(replay(type,data,size)); });
+    // success
     return(true);
 }
 //////////////////////////////////////////////////////////////////////////
-// shutdown
+// start health monitor
 //////////////////////////////////////////////////////////////////////////
-void Database::shutdown()
+bool Database::initMonitor(UINT interval,UINT backoff_min,UINT backoff_max)
 {
-    // disconnect
-    if(connected())
-        disconnect();
-    // logout
-    Logger::get().log("'%s': database '%s@%s' shutdown",mUser.c_str(),mSrvc.c_str(),mHost.c_str());
+    // checks
+    if(mMonitor || mSessions.empty() || interval==0 || backoff_min==0)
+        return(false);
+    // copy params
+    mInterval  =interval;
+    mBackoffMin=backoff_min;
+    mBackoffMax=backoff_max<backoff_min ? backoff_min : backoff_max;
+    // start thread
+    mStop.store(false);
+    mMonitor=new std::thread(&Database::funcWrapMonitor,this);
+    Logger::get().log("'%s': health monitor started, ping %u ms, reconnect backoff %u-%u ms",mSrvc.c_str(),mInterval,mBackoffMin,mBackoffMax);
+    // success
+    return(true);
 }
 //////////////////////////////////////////////////////////////////////////
-// prices commit
+// connect to db
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitQuote(const TransQuote *trans)
+bool Database::connect()
 {
-    bool res=false;
-    // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
-    // check
-    if(mProcPriceUpdate==nullptr)
-    {
-        mSync.unlock();
-        return(false);
-    }
-    // copy data
-    memcpy(&mRowQuote,trans,sizeof(mRowQuote));
-    // execute procedure
-    try
-    {
-        res=mProcPriceUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' quote [%s]",mSrvc.c_str(),trans->data.symbol,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
+    bool res=true;
+    // monitor reconnects in background
+    if(mMonitor)
     {
-        Logger::get().log("'%s': failed to commit '%s' quote [%s]",mSrvc.c_str(),trans->data.symbol,e.what());
-        mSync.unlock();
-        return(false);
+        mMonitorSync.lock();
+        mMonitorCond.notify_all();
+        mMonitorSync.unlock();
+        return(connected());
     }
+    // lock
+    mSync.lock();
+    // reconnect lost sessions only
+    for(size_t i=0;i<mSessions.size();i++)
+        if(!mHealthy[i].load() && !reconnect(i))
+            res=false;
     // unlock
     mSync.unlock();
+    // replay spooled transactions in order
+    if(res && mSpool.active())
+        mSpool.replay([this](UINT type,const void *data,UINT size) { return(replay(type,data,size)); });
     // result
     return(res);
 }
 //////////////////////////////////////////////////////////////////////////
-// user commit
+// state of sessions, checked by monitor or failed commits
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitUser(const TransUser *trans)
+bool Database::connected()
 {
-    bool res=false;
-    // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
+    ActiveScope scope(*this);
     // checks
-    if(mProcUserUpdate==nullptr)
-    {
-        mSync.unlock();
+    if(!scope.entered())
         return(false);
-    }
-    // copy data
-    memcpy(&mRowUser,trans,sizeof(mRowUser));
-    // execute procedure
-    try
-    {
-        res=mProcUserUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit user '#%d' [%s]",mSrvc.c_str(),trans->data.login,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit user '#%d' [%s]",mSrvc.c_str(),trans->data.login,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    // unlock
-    mSync.unlock();
-    // log info
-    Logger::get().log("'%s': committed user '#%d'",mSrvc.c_str(),trans->data.login);
-    // result
-    return(res);
+    return(healthy());
 }
 //////////////////////////////////////////////////////////////////////////
-// trade commit
+// shutdown
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitTrade(const TransTrade *trans)
+void Database::shutdown()
 {
-    bool res=false;
-    // checks
-    if(trans==nullptr)
-        return(false);
+    // stop monitor
+    if(mMonitor)
+    {
+        mStop.store(true);
+        mMonitorSync.lock();
+        mMonitorCond.notify_all();
+        mMonitorSync.unlock();
+        mMonitor->join();
+        delete(mMonitor);
+        mMonitor=nullptr;
+    }
+    // refuse new calls and wait for in-flight ones
+    mClosing.store(true);
+    while(mActive.load()!=0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     // lock
     mSync.lock();
     // check
-    if(mProcTradeUpdate==nullptr)
-    {
-        mSync.unlock();
-        return(false);
-    }
-    // copy data
-    memcpy(&mRowTrade,trans,sizeof(mRowTrade));
-    // execute procedure
-    try
-    {
-        res=mProcTradeUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
+    if(mSessions.empty())
     {
-        Logger::get().log("'%s': failed to commit trade '%d' [%s]",mSrvc.c_str(),trans->data.order,e.what());
         mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit trade '%d' [%s]",mSrvc.c_str(),trans->data.order,e.what());
-        mSync.unlock();
-        return(false);
+        return;
     }
+    // close sessions
+    mSessions.clear();
+    mHealthy.reset();
     // unlock
     mSync.unlock();
-    // log info
-    Logger::get().log("'%s': committed trade '%d'",mSrvc.c_str(),trans->data.order);
-    // result
-    return(res);
+    // flush spool
+    mSpool.shutdown();
+    // logout
+    Logger::get().log("'%s': database '%s@%s' shutdown",mUser.c_str(),mSrvc.c_str(),mHost.c_str());
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// enter sessions pool, fails while pool is closing
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitSymbol(const TransSymbol *trans)
+bool Database::enter()
 {
-	bool res=false;
-    // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
-    // checks
-    if(mProcSymbolUpdate==nullptr)
+    mActive.fetch_add(1);
+    // shutdown sets flag before it waits for counter
+    if(mClosing.load())
     {
-        mSync.unlock();
+        mActive.fetch_sub(1);
         return(false);
     }
-	// copy data
-	memcpy(&mRowSymbol,trans,sizeof(mRowSymbol));
-    // execute procedure
-    try
-    {
-        res=mProcSymbolUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' symbol [%s]",mSrvc.c_str(),trans->data.symbol,e.what());
-        mSync.unlock();
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// leave sessions pool
+//////////////////////////////////////////////////////////////////////////
+void Database::leave()
+{
+    mActive.fetch_sub(1);
+}
+//////////////////////////////////////////////////////////////////////////
+// session slot by key
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t Database::slot(const T *trans) const
+{
+    // single session
+    if(mSessions.size()<2)
+        return(0);
+    // fixed session by key
+    return(TransKey::key(trans)%mSessions.size());
+}
+//////////////////////////////////////////////////////////////////////////
+// current session of slot
+//////////////////////////////////////////////////////////////////////////
+std::shared_ptr<DatabaseSession> Database::session(size_t idx) const
+{
+    // checks
+    if(idx>=mSessions.size())
+        return(nullptr);
+    return(std::atomic_load(&mSessions[idx]));
+}
+//////////////////////////////////////////////////////////////////////////
+// all sessions are up
+//////////////////////////////////////////////////////////////////////////
+bool Database::healthy() const
+{
+    // check empty pool
+    if(mSessions.empty())
         return(false);
-    }
-    catch(soci::soci_error &e)
+    // cached state, no ping on caller thread
+    for(size_t i=0;i<mSessions.size();i++)
+        if(!mHealthy[i].load(std::memory_order_relaxed))
+            return(false);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// create session of configured backend
+//////////////////////////////////////////////////////////////////////////
+DatabaseSession *Database::create(int index) const
+{
+    switch(mBackend)
     {
-        Logger::get().log("'%s': failed to commit '%s' symbol [%s]",mSrvc.c_str(),trans->data.symbol,e.what());
-        mSync.unlock();
-        return(false);
+        case BACKEND_SQLITE: return(new SQLiteSession(mSrvc,index));
+        case BACKEND_FILE:   return(new FileSession(mSrvc,index));
     }
-    // unlock
-    mSync.unlock();
-    // log info
-    Logger::get().log("'%s': committed symbol '%s'",mSrvc.c_str(),trans->data.symbol);
-	// result
-	return(res);
+    return(new MySQLSession(mSrvc,index));
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// open fresh session off to the side and swap it into slot
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitGroup(const TransGroup *trans)
+bool Database::reconnect(size_t idx)
 {
-    bool res=false;
     // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
+    if(idx>=mSessions.size())
+        return(false);
+    // first connect of slot is not a reconnect
+    bool initial=!session(idx);
+    // open session and prepare statements without any lock held,
+    // session is healthy only with all statements prepared
+    std::shared_ptr<DatabaseSession> fresh(create((int)idx));
+    if(!fresh->connect(mConn))
+        return(false);
+    // swap, old session is closed by its last user
+    std::atomic_store(&mSessions[idx],fresh);
+    mHealthy[idx].store(true);
+    // log info
+    Logger::get().log("'%s': session #%d connected to '%s@%s' database",mUser.c_str(),fresh->index(),mSrvc.c_str(),mHost.c_str());
+    if(!initial)
+        mReconnects->add();
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// session failed
+//////////////////////////////////////////////////////////////////////////
+void Database::markDown(size_t idx)
+{
     // checks
-    if(mProcGroupUpdate==nullptr)
-    {
-        mSync.unlock();
-        return(false);
+    if(idx>=mSessions.size() || !mHealthy[idx].exchange(false))
+        return;
+    if(mUp)
+        mUp->set(0);
+    Logger::get().log("'%s': session #%u lost connection to '%s@%s' database",mUser.c_str(),(UINT)idx,mSrvc.c_str(),mHost.c_str());
+    // wake monitor
+    if(mMonitor)
+    {
+        mMonitorSync.lock();
+        mMonitorCond.notify_all();
+        mMonitorSync.unlock();
     }
-    // copy data
-    memcpy(&mRowGroup,trans,sizeof(mRowGroup));
-    // execute procedure
-    try
-    {
-        res=mProcGroupUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' group [%s]",mSrvc.c_str(),trans->data.group,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' group [%s]",mSrvc.c_str(),trans->data.group,e.what());
-        mSync.unlock();
-        return(false);
+}
+//////////////////////////////////////////////////////////////////////////
+// monitor thread
+//////////////////////////////////////////////////////////////////////////
+void Database::funcWrapMonitor(void *param)
+{
+    if(param)
+        static_cast<Database*>(param)->runMonitor();
+}
+//////////////////////////////////////////////////////////////////////////
+// ping sessions and reconnect lost ones with exponential backoff
+//////////////////////////////////////////////////////////////////////////
+void Database::runMonitor()
+{
+    size_t count=mSessions.size();
+    std::vector<UINT> backoff(count,mBackoffMin);
+    std::vector<bool> seen(count,false);
+    std::vector<std::chrono::steady_clock::time_point> next(count,std::chrono::steady_clock::now());
+    // name and pin monitor
+    ThreadPlacement::get().apply(ThreadPlacement::ROLE_SERVICE,0);
+    // loop
+    while(!mStop.load())
+    {
+        bool up=true;
+        // check sessions
+        for(size_t i=0;i<count && !mStop.load();i++)
+        {
+            std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+            bool state=mHealthy[i].load();
+            // session marked down by commit, retry at once
+            if(seen[i] && !state)
+            {
+                next[i]   =now;
+                backoff[i]=mBackoffMin;
+            }
+            seen[i]=state;
+            if(now<next[i])
+            {
+                up=up && state;
+                continue;
+            }
+            // ping live session
+            if(state)
+            {
+                std::shared_ptr<DatabaseSession> sess=session(i);
+                if(sess && sess->connected())
+                {
+                    next[i]=now+std::chrono::milliseconds(mInterval);
+                    continue;
+                }
+                markDown(i);
+                seen[i]=false;
+            }
+            // reconnect with backoff
+            if(reconnect(i))
+            {
+                seen[i]   =true;
+                backoff[i]=mBackoffMin;
+                next[i]   =std::chrono::steady_clock::now()+std::chrono::milliseconds(mInterval);
+                continue;
+            }
+            up=false;
+            next[i]   =std::chrono::steady_clock::now()+std::chrono::milliseconds(backoff[i]);
+            backoff[i]=backoff[i]>mBackoffMax/2 ? mBackoffMax : backoff[i]*2;
+        }
+        if(mUp)
+            mUp->set(up ? 1 : 0);
+        // replay transactions spooled while database was down
+        if(up && mSpool.active())
+            mSpool.replay([this](UINT type,const void *data,UINT size) { return(replay(type,data,size)); });
+        // sleep
+        std::unique_lock<std::mutex> lock(mMonitorSync);
+        mMonitorCond.wait_for(lock,std::chrono::milliseconds(mBackoffMin<mInterval ? mBackoffMin : mInterval),[this]() { return(mStop.load()); });
     }
-    // unlock
-    mSync.unlock();
-    // log info
-    Logger::get().log("'%s': committed group '%s'",mSrvc.c_str(),trans->data.group);
-    // result
-    return(res);
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// commit or spool single transaction
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitSymbolGroup(const TransSymbolGroup *trans)
+template<class T>
+bool Database::commit(bool (DatabaseSession::*func)(const T*,int),const T *trans,UINT type,int sid)
 {
-    bool res=false;
+    ActiveScope scope(*this);
     // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
+    if(trans==nullptr || !scope.entered() || mSessions.empty())
+        return(false);
+    // earlier transactions are still spooled, keep order
+    if(spool(trans,type,sid,true))
+    {
+        mSpooled[type]->add();
+        return(true);
+    }
+    size_t idx=slot(trans);
+    std::shared_ptr<DatabaseSession> sess=session(idx);
+    // commit on live session
+    if(sess && mHealthy[idx].load(std::memory_order_relaxed))
+    {
+        {
+            MetricTimer timer(mLatency[type]);
+            if((sess.get()->*func)(trans,sid))
+            {
+                mCommitted[type]->add();
+                changed(sid,trans);
+                return(true);
+            }
+        }
+        // connection lost, monitor reconnects
+        if(!sess->connected())
+            markDown(idx);
+    }
+    // database is unreachable, spool until reconnect
+    if(!mHealthy[idx].load() && spool(trans,type,sid,false))
+    {
+        mSpooled[type]->add();
+        return(true);
+    }
+    // failed
+    mFailed[type]->add();
+    return(false);
+}
+//////////////////////////////////////////////////////////////////////////
+// spool transaction, active only appends behind records already spooled
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool Database::spool(const T *trans,UINT type,int sid,bool active)
+{
+    char        buf[sizeof(SpoolRecord)+sizeof(trans->data)];
+    SpoolRecord rec;
+    // only data is stored, transaction object is rebuilt on replay
+    rec.sid=sid;
+    memcpy(buf,&rec,sizeof(rec));
+    memcpy(buf+sizeof(rec),&trans->data,sizeof(trans->data));
+    // append
+    if(active)
+        return(mSpool.appendIfActive(type,buf,sizeof(buf)));
+    return(mSpool.append(type,buf,sizeof(buf)));
+}
+//////////////////////////////////////////////////////////////////////////
+// replay spooled transaction
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool Database::replay(bool (DatabaseSession::*func)(const T*,int),const void *data,UINT size)
+{
+    SpoolRecord rec;
+    T          *trans;
+    bool        res=false;
+    ActiveScope scope(*this);
     // checks
-    if(mProcSymbolGroupUpdate==nullptr)
-    {
-        mSync.unlock();
-        return(false);
-    }
-    // copy data
-    memcpy(&mRowSymbolGroup,trans,sizeof(mRowSymbolGroup));
-    // execute procedure
-    try
-    {
-        res=mProcSymbolGroupUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' symbol group [%s]",mSrvc.c_str(),trans->data.name,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit '%s' symbol group [%s]",mSrvc.c_str(),trans->data.name,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    // unlock
-    mSync.unlock();
-    // log info
-    Logger::get().log("'%s': committed symbol group '%s'",mSrvc.c_str(),trans->data.name);
-    // result
+    if(!scope.entered() || mSessions.empty())
+        return(false);
+    // record of other build, do not block the rest of spool
+    if(size!=sizeof(rec)+sizeof(trans->data))
+    {
+        Logger::get().log("'%s': skipped spooled record of size %u",mSrvc.c_str(),size);
+        return(true);
+    }
+    // rebuild transaction from stored data
+    if((trans=TransAllocator::get().alloc<T>())==nullptr)
+        return(false);
+    memcpy(&rec,data,sizeof(rec));
+    memcpy(&trans->data,static_cast<const char*>(data)+sizeof(rec),sizeof(trans->data));
+    size_t idx=slot(trans);
+    std::shared_ptr<DatabaseSession> sess=session(idx);
+    if(sess && mHealthy[idx].load())
+    {
+        // commit, transaction is logged only now it is in database
+        if((sess.get()->*func)(trans,rec.sid))
+        {
+            changed(rec.sid,trans);
+            res=true;
+        }
+        else
+            // connection lost again, stop replay and keep record
+            if(!sess->connected())
+                markDown(idx);
+            else
+            {
+                // rejected by database, do not block the rest of spool
+                Logger::get().log("'%s': spooled transaction rejected, skipped",mSrvc.c_str());
+                res=true;
+            }
+    }
+    TransAllocator::get().release(trans);
     return(res);
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// replay spooled transaction by type
 //////////////////////////////////////////////////////////////////////////
-bool Database::commitMargin(const TransMargin *trans)
+bool Database::replay(UINT type,const void *data,UINT size)
 {
-    bool res=false;
-    // checks
-    if(trans==nullptr)
-        return(false);
-    // lock
-    mSync.lock();
+    switch(type)
+    {
+        case COMMIT_QUOTE:       return(replay(&DatabaseSession::commitQuote,      data,size));
+        case COMMIT_TRADE:       return(replay(&DatabaseSession::commitTrade,      data,size));
+        case COMMIT_USER:        return(replay(&DatabaseSession::commitUser,       data,size));
+        case COMMIT_SYMBOL:      return(replay(&DatabaseSession::commitSymbol,     data,size));
+        case COMMIT_GROUP:       return(replay(&DatabaseSession::commitGroup,      data,size));
+        case COMMIT_SYMBOLGROUP: return(replay(&DatabaseSession::commitSymbolGroup,data,size));
+        case COMMIT_MARGIN:      return(replay(&DatabaseSession::commitMargin,     data,size));
+    }
+    // unknown record is skipped
+    Logger::get().log("'%s': skipped spooled record of type %u and size %u",mSrvc.c_str(),type,size);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// commits
+//////////////////////////////////////////////////////////////////////////
+bool Database::commitQuote(const TransQuote *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitQuote,trans,COMMIT_QUOTE,sid));
+}
+bool Database::commitUser(const TransUser *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitUser,trans,COMMIT_USER,sid));
+}
+bool Database::commitTrade(const TransTrade *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitTrade,trans,COMMIT_TRADE,sid));
+}
+bool Database::commitSymbol(const TransSymbol *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitSymbol,trans,COMMIT_SYMBOL,sid));
+}
+bool Database::commitGroup(const TransGroup *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitGroup,trans,COMMIT_GROUP,sid));
+}
+bool Database::commitSymbolGroup(const TransSymbolGroup *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitSymbolGroup,trans,COMMIT_SYMBOLGROUP,sid));
+}
+bool Database::commitMargin(const TransMargin *trans,int sid)
+{
+    return(commit(&DatabaseSession::commitMargin,trans,COMMIT_MARGIN,sid));
+}
+//////////////////////////////////////////////////////////////////////////
+// batch commit, failed rows are spooled while database is unreachable
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t Database::commitBatch(size_t (DatabaseSession::*func)(const T*,const int*,size_t,bool*),const T *trans,const int *sids,size_t count,bool *results,UINT type)
+{
+    size_t committed=0;
+    ActiveScope scope(*this);
     // checks
-    if(mProcMarginUpdate==nullptr)
-    {
-        mSync.unlock();
-        return(false);
-    }
-    // copy data
-    memcpy(&mRowMargin,trans,sizeof(mRowMargin));
-    // execute procedure
-    try
-    {
-        res=mProcMarginUpdate->execute(true);
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit user '#%d' margin level [%s]",mSrvc.c_str(),trans->data.login,e.what());
-        mSync.unlock();
-        return(false);
-    }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to commit user '#%d' margin level [%s]",mSrvc.c_str(),trans->data.login,e.what());
-        mSync.unlock();
-        return(false);
+    if(trans==nullptr || count==0 || !scope.entered() || mSessions.empty())
+        return(0);
+    // earlier transactions are still spooled, keep order
+    while(count>0 && spool(trans,type,sids ? *sids : 0,true))
+    {
+        if(results)
+            *results++=true;
+        if(sids)
+            sids++;
+        trans++;
+        count--;
+        committed++;
+        mSpooled[type]->add();
+    }
+    if(count==0)
+        return(committed);
+    // session is down, spool whole batch to keep order
+    if(!healthy())
+    {
+        for(size_t i=0;i<count;i++)
+        {
+            bool spooled=spool(&trans[i],type,sids ? sids[i] : 0,false);
+            if(results)
+                results[i]=spooled;
+            if(spooled)
+            {
+                committed++;
+                mSpooled[type]->add();
+            }
+            else
+                mFailed[type]->add();
+        }
+        return(committed);
+    }
+    // per-row results are needed to spool failed rows
+    std::unique_ptr<bool[]> rowres;
+    if(results==nullptr)
+    {
+        rowres.reset(new bool[count]);
+        results=rowres.get();
+    }
+    // commit rows
+    size_t rows;
+    {
+        MetricTimer timer(mBatchLatency[type]);
+        // single session, pass through
+        if(mSessions.size()==1)
+        {
+            std::shared_ptr<DatabaseSession> sess=session(0);
+            rows=(sess.get()->*func)(trans,sids,count,results);
+        }
+        else
+            rows=commitSplit(func,trans,sids,count,results);
+    }
+    mCommitted[type]->add(rows);
+    committed+=rows;
+    // log committed rows, spool rows failed because database is unreachable, ping each session once
+    std::vector<int> state(mSessions.size(),-1);
+    for(size_t i=0;i<count;i++)
+    {
+        if(results[i])
+        {
+            changed(sids ? sids[i] : 0,&trans[i]);
+            continue;
+        }
+        size_t idx=slot(&trans[i]);
+        if(state[idx]<0)
+        {
+            std::shared_ptr<DatabaseSession> sess=session(idx);
+            state[idx]=sess && sess->connected() ? 1 : 0;
+            // connection lost, monitor reconnects
+            if(state[idx]==0)
+                markDown(idx);
+        }
+        // spool row
+        if(state[idx]==0 && spool(&trans[i],type,sids ? sids[i] : 0,false))
+        {
+            results[i]=true;
+            committed++;
+            mSpooled[type]->add();
+            continue;
+        }
+        mFailed[type]->add();
     }
-    // unlock
-    mSync.unlock();
-    // log info
-    //Logger::get().log("'%s': committed margin level for user [#%d]",mSrvc.c_str(),trans->data.login);
     // result
-    return(res);
+    return(committed);
 }
-////////////////////////////////////////////////////////////////////////
-// prepare procedures
-////////////////////////////////////////////////////////////////////////
-bool Database::prepare()
+//////////////////////////////////////////////////////////////////////////
+// split batch between sessions preserving rows order inside each key
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t Database::commitSplit(size_t (DatabaseSession::*func)(const T*,const int*,size_t,bool*),const T *trans,const int *sids,size_t count,bool *results)
 {
-    // logout
-    Logger::get().log("'%s': preparing stored functions",mSrvc.c_str());
-    try
-    {
-        // create procedures
-        mProcPriceUpdate      =new soci::procedure((mSQL.prepare << PROC_UPDATE_PRICE,      soci::use(mRowQuote)));
-        mProcUserUpdate       =new soci::procedure((mSQL.prepare << PROC_UPDATE_USER,       soci::use(mRowUser)));
-        mProcTradeUpdate      =new soci::procedure((mSQL.prepare << PROC_UPDATE_TRADE,      soci::use(mRowTrade)));
-        mProcSymbolUpdate     =new soci::procedure((mSQL.prepare << PROC_UPDATE_SYMBOL,     soci::use(mRowSymbol)));
-        mProcGroupUpdate      =new soci::procedure((mSQL.prepare << PROC_UPDATE_GROUP,      soci::use(mRowGroup)));
-        mProcSymbolGroupUpdate=new soci::procedure((mSQL.prepare << PROC_UPDATE_SYMBOLGROUP,soci::use(mRowSymbolGroup)));
-        mProcMarginUpdate     =new soci::procedure((mSQL.prepare << PROC_UPDATE_MARGIN,     soci::use(mRowMargin)));
-    }
-    catch(soci::mysql_soci_error &e)
-    {
-        Logger::get().log("'%s': failed to prepare mysql stored functions [%s]",mSrvc.c_str(),e.what());
-        return(false);
+    size_t committed=0;
+    // split rows by session
+    std::vector<std::vector<T>>      rows(mSessions.size());
+    std::vector<std::vector<int>>    rowsids(mSessions.size());
+    std::vector<std::vector<size_t>> pos(mSessions.size());
+    for(size_t i=0;i<count;i++)
+    {
+        size_t idx=slot(&trans[i]);
+        rows[idx].push_back(trans[i]);
+        rowsids[idx].push_back(sids ? sids[i] : 0);
+        pos[idx].push_back(i);
+    }
+    // commit sub-batches
+    for(size_t idx=0;idx<mSessions.size();idx++)
+    {
+        if(rows[idx].empty())
+            continue;
+        // per-row results of sub-batch
+        std::unique_ptr<bool[]> res(new bool[rows[idx].size()]);
+        std::shared_ptr<DatabaseSession> sess=session(idx);
+        committed+=(sess.get()->*func)(rows[idx].data(),rowsids[idx].data(),rows[idx].size(),res.get());
+        // map results back
+        if(results)
+            for(size_t i=0;i<rows[idx].size();i++)
+                results[pos[idx][i]]=res[i];
     }
-    catch(soci::soci_error &e)
-    {
-        Logger::get().log("'%s': failed to prepare database objects [%s]",mSrvc.c_str(),e.what());
-        return(false);
-    }
-    // success
-    return(true);
+    // result
+    return(committed);
 }
-////////////////////////////////////////////////////////////////////////
-// release CLOBs and procedures
-////////////////////////////////////////////////////////////////////////
-void Database::release()
+//////////////////////////////////////////////////////////////////////////
+// batch commits
+//////////////////////////////////////////////////////////////////////////
+size_t Database::commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)
 {
-    // logout
-    Logger::get().log("'%s': releasing stored functions",mSrvc.c_str());
-    // release func's
-    if(mProcPriceUpdate)        { delete(mProcPriceUpdate);       mProcPriceUpdate      =nullptr; }
-    if(mProcUserUpdate)         { delete(mProcUserUpdate);        mProcUserUpdate       =nullptr; }
-    if(mProcTradeUpdate)        { delete(mProcTradeUpdate);       mProcTradeUpdate      =nullptr; }
-    if(mProcSymbolUpdate)       { delete(mProcSymbolUpdate);      mProcSymbolUpdate     =nullptr; }
-    if(mProcGroupUpdate)        { delete(mProcGroupUpdate);       mProcSymbolUpdate     =nullptr; }
-    if(mProcSymbolGroupUpdate)  { delete(mProcSymbolGroupUpdate); mProcSymbolGroupUpdate=nullptr; }
-    if(mProcMarginUpdate)       { delete(mProcMarginUpdate);      mProcMarginUpdate     =nullptr; }
+    return(commitBatch(&DatabaseSession::commitQuotes,trans,sids,count,results,COMMIT_QUOTE));
+}
+size_t Database::commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitTrades,trans,sids,count,results,COMMIT_TRADE));
+}
+size_t Database::commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitUsers,trans,sids,count,results,COMMIT_USER));
+}
+size_t Database::commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitSymbols,trans,sids,count,results,COMMIT_SYMBOL));
+}
+size_t Database::commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitGroups,trans,sids,count,results,COMMIT_GROUP));
+}
+size_t Database::commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitSymbolGroups,trans,sids,count,results,COMMIT_SYMBOLGROUP));
+}
+size_t Database::commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::commitMargins,trans,sids,count,results,COMMIT_MARGIN));
 }
 //////////////////////////////////////////////////////////////////////////
-//
+// bulk loads
 //////////////////////////////////////////////////////////////////////////
-void Database::disconnect()
+size_t Database::loadTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)
 {
-    // release procedures and blobs
-    release();
-    // close connections
-    mSQL.close();
-    // logout
-    Logger::get().log("'%s': disconnected from '%s@%s' database",mUser.c_str(),mSrvc.c_str(),mHost.c_str());
+    return(commitBatch(&DatabaseSession::loadTrades,trans,sids,count,results,COMMIT_TRADE));
+}
+size_t Database::loadUsers(const TransUser *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::loadUsers,trans,sids,count,results,COMMIT_USER));
+}
+size_t Database::loadSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::loadSymbols,trans,sids,count,results,COMMIT_SYMBOL));
+}
+size_t Database::loadGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::loadGroups,trans,sids,count,results,COMMIT_GROUP));
+}
+size_t Database::loadSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results)
+{
+    return(commitBatch(&DatabaseSession::loadSymbolGroups,trans,sids,count,results,COMMIT_SYMBOLGROUP));
 }
@@ -5,12 +5,40 @@
 #pragma once
 #include "Manager.h"
 #include "Transactions.h"
+#include "DatabaseSession.h"
+#include "Spool.h"
+#include "ChangeLog.h"
+#include "Metrics.h"
+
+//////////////////////////////////////////////////////////////////////////
+// type definitions
+//////////////////////////////////////////////////////////////////////////
+typedef std::vector<std::shared_ptr<DatabaseSession>> DatabaseSessionArray;
 
 //////////////////////////////////////////////////////////////////////////
 // SQL database class
 //////////////////////////////////////////////////////////////////////////
 class Database
 {
+private:
+    // committed transaction types, stored in spool records
+    enum EnCommitType
+    {
+        COMMIT_QUOTE      =1,
+        COMMIT_TRADE      =2,
+        COMMIT_USER       =3,
+        COMMIT_SYMBOL     =4,
+        COMMIT_GROUP      =5,
+        COMMIT_SYMBOLGROUP=6,
+        COMMIT_MARGIN     =7,
+        COMMIT_TYPES      =8
+    };
+    // spool record header, transaction data follows, sid is kept to log transaction once replayed
+    struct SpoolRecord
+    {
+        int             sid;
+    };
+
 private:
     // connection details
     std::string         mHost;
@@ -19,52 +47,142 @@ private:
     std::string         mPass;
     std::string         mSrvc;
     std::string         mConn;
-    // transactions lock
+    int                 mBackend;
+    // init/shutdown lock
     std::mutex          mSync;
-    // database session
-    soci::session       mSQL;
-    // database procedures
-    soci::procedure    *mProcPriceUpdate;
-    soci::procedure    *mProcUserUpdate;
-    soci::procedure    *mProcTradeUpdate;
-    soci::procedure    *mProcSymbolUpdate;
-    soci::procedure    *mProcGroupUpdate;
-    soci::procedure    *mProcSymbolGroupUpdate;
-    soci::procedure    *mProcMarginUpdate;
-    // database transactions
-    TransQuote          mRowQuote;
-    TransTrade          mRowTrade;
-    TransUser           mRowUser;
-    TransSymbol         mRowSymbol;
-    TransGroup          mRowGroup;
-    TransSymbolGroup    mRowSymbolGroup;
-    TransMargin         mRowMargin;
+    // sessions pool, every key is routed to the fixed session to keep its order,
+    // reconnected sessions are swapped in atomically
+    DatabaseSessionArray mSessions;
+    std::unique_ptr<std::atomic<bool>[]> mHealthy;
+    // calls inside sessions pool, pool is closed only after all of them leave
+    std::atomic<bool>   mClosing;
+    std::atomic<UINT>   mActive;
+    // health monitor
+    std::thread        *mMonitor;
+    std::atomic<bool>   mStop;
+    std::mutex          mMonitorSync;
+    std::condition_variable mMonitorCond;
+    UINT                mInterval;
+    UINT                mBackoffMin;
+    UINT                mBackoffMax;
+    // transactions not committed while database was unreachable
+    Spool               mSpool;
+    // log of transactions actually committed
+    std::atomic<ChangeLog*> mChangeLog;
+    // metrics by commit type
+    MetricHistogram    *mLatency[COMMIT_TYPES];
+    MetricHistogram    *mBatchLatency[COMMIT_TYPES];
+    MetricCounter      *mCommitted[COMMIT_TYPES];
+    MetricCounter      *mFailed[COMMIT_TYPES];
+    MetricCounter      *mSpooled[COMMIT_TYPES];
+    MetricCounter      *mReconnects;
+    MetricGauge        *mUp;
+
+public:
+    // storage backends
+    enum EnBackend
+    {
+        BACKEND_MYSQL =0,               // MySQL stored procedures
+        BACKEND_SQLITE=1,               // embedded SQLite file, path in host
+        BACKEND_FILE  =2                // append-only record files, directory in host
+    };
 
 public:
     // ctor/dtor
     Database();
     virtual ~Database();
     // init/shutdown
-    bool            init(char *host,char *port,char *user,char *pass,char *schema);
+    bool            init(char *host,char *port,char *user,char *pass,char *schema,int pool=1,int backend=BACKEND_MYSQL);
+    bool            initSpool(const std::string &path,UINT flush);
+    // start health monitor, ping interval and reconnect backoff range in ms
+    bool            initMonitor(UINT interval,UINT backoff_min,UINT backoff_max);
     void            shutdown();
-    // connect
-    bool            connect();
-    bool            connected();
+    // log committed transactions, spooled ones are logged once replayed
+    void            initChangeLog(ChangeLog *changelog) { mChangeLog.store(changelog); }
+    // connect, with running monitor only wakes it up and never blocks
+    virtual bool    connect();
+    virtual bool    connected();
+    // backend by config name
+    static int      backend(const char *name);
     // database id
     const std::string id() const { return(mSrvc); }
-    // commit transactions
-    bool            commitQuote(const TransQuote *trans);
-    bool            commitTrade(const TransTrade *trans);
-    bool            commitUser(const TransUser *trans);
-    bool            commitSymbol(const TransSymbol *trans);
-    bool            commitGroup(const TransGroup *trans);
-    bool            commitSymbolGroup(const TransSymbolGroup *trans);
-    bool            commitMargin(const TransMargin *trans);
+    // sessions pool size
+    size_t          sessions() const { return(mSessions.size()); }
+    // commit transactions, virtual for in-process stand-ins, sid goes to change log
+    virtual bool    commitQuote(const TransQuote *trans,int sid=0);
+    virtual bool    commitTrade(const TransTrade *trans,int sid=0);
+    virtual bool    commitUser(const TransUser *trans,int sid=0);
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid=0);
+    virtual bool    commitGroup(const TransGroup *trans,int sid=0);
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid=0);
+    virtual bool    commitMargin(const TransMargin *trans,int sid=0);
+    // batch commit transactions, one SQL transaction per batch, returns number of committed rows,
+    // sids of rows go to change log, nullptr - all rows are of sid 0
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results=nullptr);
+    // bulk load snapshot rows, committed as batch by every backend
+    virtual size_t  loadTrades(const TransTrade *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  loadUsers(const TransUser *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  loadSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  loadGroups(const TransGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  loadSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+
+protected:
+    // append committed transaction to change log
+    template<class T>
+    void            changed(int sid,const T *trans) { ChangeLog *changelog=mChangeLog.load(); if(changelog) changelog->append(sid,trans); }
+
+private:
+    // in-flight call guard, entered call keeps sessions pool and states alive
+    class ActiveScope
+    {
+    private:
+        Database       &mDB;
+        bool            mEntered;
+    public:
+        explicit ActiveScope(Database &db) : mDB(db),mEntered(db.enter()) {}
+        ~ActiveScope() { if(mEntered) mDB.leave(); }
+        bool            entered() const { return(mEntered); }
+    };
 
 private:
-    // stored procedures
-    void            release();
-    bool            prepare();
-    // disconnect
-    void            disconnect();
+    // enter/leave sessions pool
+    bool            enter();
+    void            leave();
+    // session slot by key
+    template<class T>
+    size_t          slot(const T *trans) const;
+    // current session of slot
+    std::shared_ptr<DatabaseSession> session(size_t idx) const;
+    // all sessions are up
+    bool            healthy() const;
+    // open fresh session and swap it into slot
+    DatabaseSession *create(int index) const;
+    bool            reconnect(size_t idx);
+    // session failed, hand it over to monitor
+    void            markDown(size_t idx);
+    // monitor thread
+    static void     funcWrapMonitor(void *param);
+    void            runMonitor();
+    // commit or spool single transaction
+    template<class T>
+    bool            commit(bool (DatabaseSession::*func)(const T*,int),const T *trans,UINT type,int sid);
+    // spool transaction
+    template<class T>
+    bool            spool(const T *trans,UINT type,int sid,bool active);
+    // replay spooled transactions
+    template<class T>
+    bool            replay(bool (DatabaseSession::*func)(const T*,int),const void *data,UINT size);
+    bool            replay(UINT type,const void *data,UINT size);
+    // batch commit, failed rows are spooled while database is unreachable
+    template<class T>
+    size_t          commitBatch(size_t (DatabaseSession::*func)(const T*,const int*,size_t,bool*),const T *trans,const int *sids,size_t count,bool *results,UINT type);
+    // split batch between sessions
+    template<class T>
+    size_t          commitSplit(size_t (DatabaseSession::*func)(const T*,const int*,size_t,bool*),const T *trans,const int *sids,size_t count,bool *results);
 };
@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////
+// DatabaseSession.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+
+//////////////////////////////////////////////////////////////////////////
+// storage backend session behind Database commit API
+//////////////////////////////////////////////////////////////////////////
+class DatabaseSession
+{
+protected:
+    // session identifier
+    std::string         mSrvc;
+    int                 mIndex;
+
+public:
+    // ctor/dtor
+    DatabaseSession(const std::string &srvc,int index) : mSrvc(srvc),mIndex(index) {}
+    virtual ~DatabaseSession() {}
+    // connect
+    virtual bool    connect(const std::string &conn)=0;
+    virtual bool    connected()=0;
+    // session index in pool
+    int             index() const { return(mIndex); }
+    // commit transactions, sid is server transaction came from
+    virtual bool    commitQuote(const TransQuote *trans,int sid)=0;
+    virtual bool    commitTrade(const TransTrade *trans,int sid)=0;
+    virtual bool    commitUser(const TransUser *trans,int sid)=0;
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid)=0;
+    virtual bool    commitGroup(const TransGroup *trans,int sid)=0;
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid)=0;
+    virtual bool    commitMargin(const TransMargin *trans,int sid)=0;
+    // batch commit transactions, one transaction per batch, returns number of committed rows,
+    // sids of rows, nullptr - all rows are of sid 0
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results)=0;
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)=0;
+    // bulk load of snapshot rows, committed as batch
+    virtual size_t  loadTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)                 { return(commitTrades(trans,sids,count,results));       }
+    virtual size_t  loadUsers(const TransUser *trans,const int *sids,size_t count,bool *results)                   { return(commitUsers(trans,sids,count,results));        }
+    virtual size_t  loadSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)               { return(commitSymbols(trans,sids,count,results));      }
+    virtual size_t  loadGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)                 { return(commitGroups(trans,sids,count,results));       }
+    virtual size_t  loadSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results)     { return(commitSymbolGroups(trans,sids,count,results)); }
+};
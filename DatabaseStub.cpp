@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////
+// DatabaseStub.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "DatabaseStub.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+DatabaseStub::DatabaseStub()
+    : mLatency(0),
+      mRowLatency(0),
+      mJitter(0),
+      mSerialize(false),
+      mGenerator(nullptr),
+      mStart(std::chrono::steady_clock::now())
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+DatabaseStub::~DatabaseStub()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// init
+//////////////////////////////////////////////////////////////////////////
+void DatabaseStub::init(UINT latency,UINT row,UINT jitter,bool serialize,const LoadGenerator *generator)
+{
+    mLatency   =latency;
+    mRowLatency=row;
+    mJitter    =jitter;
+    mSerialize =serialize;
+    mGenerator =generator;
+    mStart     =std::chrono::steady_clock::now();
+}
+//////////////////////////////////////////////////////////////////////////
+// log results
+//////////////////////////////////////////////////////////////////////////
+void DatabaseStub::report()
+{
+    static const char *types[STUB_TYPES]={ "quote","trade","user","symbol","group","symbol group","margin" };
+    double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-mStart).count();
+    // checks
+    if(seconds<=0)
+        return;
+    // per type results
+    for(UINT i=0;i<STUB_TYPES;i++)
+    {
+        if(mRows[i].value()==0)
+            continue;
+        Logger::get().log("stub: %s rows %I64u (%.0f/s), commit us p50 %I64u p99 %I64u max %I64u, end-to-end us p50 %I64u p90 %I64u p99 %I64u p99.9 %I64u max %I64u",
+                          types[i],mRows[i].value(),mRows[i].value()/seconds,
+                          mCommitLatency[i].percentile(50),mCommitLatency[i].percentile(99),mCommitLatency[i].max(),
+                          mEndToEnd[i].percentile(50),mEndToEnd[i].percentile(90),mEndToEnd[i].percentile(99),mEndToEnd[i].percentile(99.9),mEndToEnd[i].max());
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// simulate round-trip
+//////////////////////////////////////////////////////////////////////////
+void DatabaseStub::simulate(size_t rows)
+{
+    static thread_local UINT seed=(UINT)std::hash<std::thread::id>()(std::this_thread::get_id())|1;
+    UINT64 delay=mLatency+(UINT64)mRowLatency*rows;
+    // random jitter
+    if(mJitter)
+    {
+        seed^=seed<<13; seed^=seed>>17; seed^=seed<<5;
+        delay+=seed%mJitter;
+    }
+    if(delay==0)
+        return;
+    // spin, sleep granularity is too coarse for sub-millisecond delays
+    std::chrono::steady_clock::time_point until=std::chrono::steady_clock::now()+std::chrono::microseconds(delay);
+    while(std::chrono::steady_clock::now()<until)
+        std::this_thread::yield();
+}
+//////////////////////////////////////////////////////////////////////////
+// end-to-end latency of generated transaction
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void DatabaseStub::stamp(UINT type,const T *trans)
+{
+    INT64 sent=mGenerator ? mGenerator->sent(trans) : 0;
+    if(sent>0)
+        mEndToEnd[type].add((UINT64)(LoadGenerator::now()-sent));
+}
+template<>
+void DatabaseStub::stamp(UINT,const TransSymbol*)      {}
+template<>
+void DatabaseStub::stamp(UINT,const TransGroup*)       {}
+template<>
+void DatabaseStub::stamp(UINT,const TransSymbolGroup*) {}
+//////////////////////////////////////////////////////////////////////////
+// commit rows
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t DatabaseStub::record(UINT type,const T *trans,const int *sids,size_t count,bool *results)
+{
+    // checks
+    if(trans==nullptr || count==0)
+        return(0);
+    // one round-trip per call
+    {
+        MetricTimer timer(&mCommitLatency[type]);
+        if(mSerialize)
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+            simulate(count);
+        }
+        else
+            simulate(count);
+    }
+    // record rows
+    for(size_t i=0;i<count;i++)
+    {
+        stamp(type,&trans[i]);
+        changed(sids ? sids[i] : 0,&trans[i]);
+        if(results)
+            results[i]=true;
+    }
+    mRows[type].add(count);
+    // result
+    return(count);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit single row
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool DatabaseStub::record(UINT type,const T *trans,int sid)
+{
+    return(record(type,trans,&sid,1,nullptr)==1);
+}
+//////////////////////////////////////////////////////////////////////////
+// commits
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseStub::commitQuote(const TransQuote *trans,int sid)             { return(record(STUB_QUOTE,      trans,sid)); }
+bool DatabaseStub::commitTrade(const TransTrade *trans,int sid)             { return(record(STUB_TRADE,      trans,sid)); }
+bool DatabaseStub::commitUser(const TransUser *trans,int sid)               { return(record(STUB_USER,       trans,sid)); }
+bool DatabaseStub::commitSymbol(const TransSymbol *trans,int sid)           { return(record(STUB_SYMBOL,     trans,sid)); }
+bool DatabaseStub::commitGroup(const TransGroup *trans,int sid)             { return(record(STUB_GROUP,      trans,sid)); }
+bool DatabaseStub::commitSymbolGroup(const TransSymbolGroup *trans,int sid) { return(record(STUB_SYMBOLGROUP,trans,sid)); }
+bool DatabaseStub::commitMargin(const TransMargin *trans,int sid)           { return(record(STUB_MARGIN,     trans,sid)); }
+//////////////////////////////////////////////////////////////////////////
+// batch commits
+//////////////////////////////////////////////////////////////////////////
+size_t DatabaseStub::commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)             { return(record(STUB_QUOTE,      trans,sids,count,results)); }
+size_t DatabaseStub::commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)             { return(record(STUB_TRADE,      trans,sids,count,results)); }
+size_t DatabaseStub::commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)               { return(record(STUB_USER,       trans,sids,count,results)); }
+size_t DatabaseStub::commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)           { return(record(STUB_SYMBOL,     trans,sids,count,results)); }
+size_t DatabaseStub::commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)             { return(record(STUB_GROUP,      trans,sids,count,results)); }
+size_t DatabaseStub::commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results) { return(record(STUB_SYMBOLGROUP,trans,sids,count,results)); }
+size_t DatabaseStub::commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)           { return(record(STUB_MARGIN,     trans,sids,count,results)); }
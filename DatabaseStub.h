@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+// DatabaseStub.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Database.h"
+#include "LoadGenerator.h"
+
+//////////////////////////////////////////////////////////////////////////
+// in-process stand-in for Database, simulates commit latency
+//////////////////////////////////////////////////////////////////////////
+class DatabaseStub : public Database
+{
+private:
+    // stubbed transaction types
+    enum EnStubType
+    {
+        STUB_QUOTE      =0,
+        STUB_TRADE      =1,
+        STUB_USER       =2,
+        STUB_SYMBOL     =3,
+        STUB_GROUP      =4,
+        STUB_SYMBOLGROUP=5,
+        STUB_MARGIN     =6,
+        STUB_TYPES      =7
+    };
+
+private:
+    // simulated latency in microseconds
+    UINT            mLatency;
+    UINT            mRowLatency;
+    UINT            mJitter;
+    // single session model, commits are serialized like on one connection
+    bool            mSerialize;
+    std::mutex      mSync;
+    // load source for end-to-end latency
+    const LoadGenerator *mGenerator;
+    // results
+    std::chrono::steady_clock::time_point mStart;
+    MetricCounter   mRows[STUB_TYPES];
+    MetricHistogram mCommitLatency[STUB_TYPES];
+    MetricHistogram mEndToEnd[STUB_TYPES];
+
+public:
+    // ctor/dtor
+    DatabaseStub();
+    virtual ~DatabaseStub();
+    // latency per call, per row and random jitter in microseconds
+    void            init(UINT latency,UINT row,UINT jitter,bool serialize,const LoadGenerator *generator);
+    // log throughput and latency percentiles
+    void            report();
+    // connect
+    virtual bool    connect()   { return(true); }
+    virtual bool    connected() { return(true); }
+    // commit transactions
+    virtual bool    commitQuote(const TransQuote *trans,int sid=0);
+    virtual bool    commitTrade(const TransTrade *trans,int sid=0);
+    virtual bool    commitUser(const TransUser *trans,int sid=0);
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid=0);
+    virtual bool    commitGroup(const TransGroup *trans,int sid=0);
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid=0);
+    virtual bool    commitMargin(const TransMargin *trans,int sid=0);
+    // batch commit transactions
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results=nullptr);
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results=nullptr);
+    // bulk loads are plain batches
+    virtual size_t  loadTrades(const TransTrade *trans,const int *sids,size_t count,bool *results=nullptr)             { return(commitTrades(trans,sids,count,results));       }
+    virtual size_t  loadUsers(const TransUser *trans,const int *sids,size_t count,bool *results=nullptr)               { return(commitUsers(trans,sids,count,results));        }
+    virtual size_t  loadSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results=nullptr)           { return(commitSymbols(trans,sids,count,results));      }
+    virtual size_t  loadGroups(const TransGroup *trans,const int *sids,size_t count,bool *results=nullptr)             { return(commitGroups(trans,sids,count,results));       }
+    virtual size_t  loadSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results=nullptr) { return(commitSymbolGroups(trans,sids,count,results)); }
+
+private:
+    // simulate round-trip
+    void            simulate(size_t rows);
+    // record committed rows and log them
+    template<class T>
+    size_t          record(UINT type,const T *trans,const int *sids,size_t count,bool *results);
+    // record single committed row
+    template<class T>
+    bool            record(UINT type,const T *trans,int sid);
+    template<class T>
+    void            stamp(UINT type,const T *trans);
+};
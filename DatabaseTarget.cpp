@@ -0,0 +1,368 @@
+//////////////////////////////////////////////////////////////////////////
+// DatabaseTarget.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "DatabaseTarget.h"
+#include "ThreadPlacement.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+DatabaseTarget::DatabaseTarget()
+    : mDatabase(nullptr),
+      mPrimary(false),
+      mDrainer(nullptr),
+      mResync(false),
+      mStop(false),
+      mNext(0),
+      mRunning(false),
+      mPushing(0),
+      mPaused(false),
+      mBusy(0),
+      mLatency(nullptr),
+      mLag(nullptr),
+      mDepth(nullptr),
+      mOverflow(nullptr),
+      mSpooled(nullptr),
+      mResyncMetric(nullptr)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+DatabaseTarget::~DatabaseTarget()
+{
+    // finalize work
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// initialization
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseTarget::init(Database *database,bool primary,size_t workers,size_t capacity,ChangeLog *changelog,const std::string &spool)
+{
+    // checks
+    if(database==nullptr || workers==0 || !mThreads.empty())
+        return(false);
+    mDatabase=database;
+    mPrimary =primary;
+    // committed transactions log, written by primary only once rows are in database,
+    // spooled rows are logged when replayed
+    if(mPrimary && changelog)
+        mDatabase->initChangeLog(changelog);
+    // create queue
+    if(!mQueue.init(workers,capacity,RingQueue<SharedTrans*>::WAIT_BLOCK))
+    {
+        Logger::get().log("'%s': failed to create target queue",mDatabase->id().c_str());
+        return(false);
+    }
+    // register metrics
+    std::string labels="db=\""+mDatabase->id()+"\"";
+    mLatency =Metrics::get().histogram("replication_target_latency_us",labels,"Time from enqueue to commit on target in microseconds");
+    mLag     =Metrics::get().gauge("replication_target_lag_us",labels,"Age of last transaction committed on target in microseconds");
+    mDepth   =Metrics::get().gauge("replication_target_depth",labels,"Transactions waiting for target");
+    mOverflow=Metrics::get().counter("replication_target_overflow_total",labels,"Transactions not queued for target with full queue");
+    mSpooled =Metrics::get().counter("replication_target_spooled_total",labels,"Transactions spooled behind target with full queue");
+    mResyncMetric=Metrics::get().gauge("replication_target_resync",labels,"1 while target dropped transactions and has to be resynced");
+    // overflow spool of secondary target
+    if(!mPrimary && !spool.empty() && !mSpool.init(spool,SPOOL_FLUSH))
+        Logger::get().log("'%s': failed to open target spool '%s', overflow is dropped",mDatabase->id().c_str(),spool.c_str());
+    // start workers, one per shard
+    mStop.store(false);
+    mNext.store(0);
+    for(size_t i=0;i<workers;i++)
+        mThreads.push_back(new std::thread(&DatabaseTarget::funcWrapProcess,this));
+    // spooled overflow left from previous run is drained at once
+    if(!mPrimary && !spool.empty())
+        mDrainer=new std::thread(&DatabaseTarget::funcWrapDrain,this);
+    mRunning.store(true);
+    Logger::get().log("'%s': %s target started with %u workers",mDatabase->id().c_str(),mPrimary ? "primary" : "secondary",(UINT)workers);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::shutdown()
+{
+    SharedTrans *trans;
+    // checks
+    if(mThreads.empty())
+        return;
+    // refuse new transactions and wait for producers inside push
+    mRunning.store(false);
+    while(mPushing.load()!=0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // stop workers
+    mStop.store(true);
+    mDrainSync.lock();
+    mDrainCond.notify_all();
+    mDrainSync.unlock();
+    mQueue.shutdown();
+    if(mDrainer)
+    {
+        mDrainer->join();
+        delete(mDrainer);
+        mDrainer=nullptr;
+    }
+    for(auto it : mThreads)
+    {
+        it->join();
+        delete(it);
+    }
+    mThreads.clear();
+    // release not committed
+    for(size_t i=0;i<mQueue.shards();i++)
+        while(mQueue.pop(i,trans,0))
+            trans->release();
+    // close spool, rest of overflow is drained on next start
+    mSpool.shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// hold workers, queued transactions are committed after resume
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::pause()
+{
+    mPaused.store(true);
+    // wait for commits in progress
+    while(mBusy.load()!=0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+//////////////////////////////////////////////////////////////////////////
+// release workers
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::resume()
+{
+    mPaused.store(false);
+}
+//////////////////////////////////////////////////////////////////////////
+// enqueue shared transaction
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseTarget::push(SharedTrans *trans)
+{
+    bool res=false;
+    // checks
+    if(trans==nullptr)
+        return(false);
+    // enter, shutdown sets flag before it waits for counter
+    mPushing.fetch_add(1);
+    if(!mRunning.load())
+    {
+        mPushing.fetch_sub(1);
+        return(false);
+    }
+    // spool is not drained yet, keep order behind it
+    if(!mPrimary && spool(trans,true))
+    {
+        mSpooled->add();
+        mPushing.fetch_sub(1);
+        return(true);
+    }
+    // reference for this target
+    trans->addRef();
+    // primary target applies backpressure to producers
+    if(mPrimary ? mQueue.push(trans->key(),trans) : mQueue.tryPush(trans->key(),trans))
+    {
+        mDepth->add(1);
+        mPushing.fetch_sub(1);
+        return(true);
+    }
+    trans->release();
+    // lagging secondary target is not allowed to delay others, overflow goes to spool
+    if(!mPrimary)
+    {
+        mOverflow->add();
+        if(spool(trans,false))
+        {
+            mSpooled->add();
+            mDrainSync.lock();
+            mDrainCond.notify_all();
+            mDrainSync.unlock();
+            res=true;
+        }
+        else
+            if(!mResync.exchange(true))
+            {
+                mResyncMetric->set(1);
+                Logger::get().log("'%s': target queue overflow without spool, target has to be resynced",mDatabase->id().c_str());
+            }
+    }
+    // leave
+    mPushing.fetch_sub(1);
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// spool transaction by payload type
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseTarget::spool(const SharedTrans *trans,bool active)
+{
+    switch(trans->type())
+    {
+        case SharedTrans::TYPE_QUOTE:       return(spool<TransQuote>(trans,active));
+        case SharedTrans::TYPE_TRADE:       return(spool<TransTrade>(trans,active));
+        case SharedTrans::TYPE_USER:        return(spool<TransUser>(trans,active));
+        case SharedTrans::TYPE_SYMBOL:      return(spool<TransSymbol>(trans,active));
+        case SharedTrans::TYPE_GROUP:       return(spool<TransGroup>(trans,active));
+        case SharedTrans::TYPE_SYMBOLGROUP: return(spool<TransSymbolGroup>(trans,active));
+        case SharedTrans::TYPE_MARGIN:      return(spool<TransMargin>(trans,active));
+    }
+    return(false);
+}
+//////////////////////////////////////////////////////////////////////////
+// spool server id and payload, appends only behind spooled records if active is set
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool DatabaseTarget::spool(const SharedTrans *trans,bool active)
+{
+    const T *data=trans->data<T>();
+    char     buf[sizeof(int)+sizeof(data->data)];
+    int      sid=trans->sid();
+    // record
+    memcpy(buf,&sid,sizeof(sid));
+    memcpy(buf+sizeof(sid),&data->data,sizeof(data->data));
+    // append
+    if(active)
+        return(mSpool.appendIfActive(trans->type(),buf,sizeof(buf)));
+    return(mSpool.append(trans->type(),buf,sizeof(buf)));
+}
+//////////////////////////////////////////////////////////////////////////
+// restore spooled transaction by payload type
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseTarget::restore(UINT type,const void *data,UINT size)
+{
+    switch(type)
+    {
+        case SharedTrans::TYPE_QUOTE:       return(restore<TransQuote>(data,size));
+        case SharedTrans::TYPE_TRADE:       return(restore<TransTrade>(data,size));
+        case SharedTrans::TYPE_USER:        return(restore<TransUser>(data,size));
+        case SharedTrans::TYPE_SYMBOL:      return(restore<TransSymbol>(data,size));
+        case SharedTrans::TYPE_GROUP:       return(restore<TransGroup>(data,size));
+        case SharedTrans::TYPE_SYMBOLGROUP: return(restore<TransSymbolGroup>(data,size));
+        case SharedTrans::TYPE_MARGIN:      return(restore<TransMargin>(data,size));
+    }
+    // unknown record is skipped
+    Logger::get().log("'%s': skipped target spool record of type %u and size %u",mDatabase->id().c_str(),type,size);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// rebuild spooled transaction and wait for room in queue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool DatabaseTarget::restore(const void *data,UINT size)
+{
+    T   *trans;
+    int  sid;
+    // checks
+    if(size!=sizeof(int)+sizeof(trans->data))
+    {
+        Logger::get().log("'%s': skipped target spool record of size %u",mDatabase->id().c_str(),size);
+        return(true);
+    }
+    // rebuild
+    if((trans=TransAllocator::get().alloc<T>())==nullptr)
+        return(false);
+    memcpy(&sid,data,sizeof(sid));
+    memcpy(&trans->data,static_cast<const char*>(data)+sizeof(sid),sizeof(trans->data));
+    SharedTrans *shared=SharedTrans::wrap(trans,sid);
+    // blocking push, drain thread is the only producer while spool is active
+    if(!mQueue.push(shared->key(),shared))
+    {
+        shared->release();
+        return(false);
+    }
+    mDepth->add(1);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit by payload type
+//////////////////////////////////////////////////////////////////////////
+bool DatabaseTarget::commit(const SharedTrans *trans)
+{
+    switch(trans->type())
+    {
+        case SharedTrans::TYPE_QUOTE:       return(commit(&Database::commitQuote,      trans));
+        case SharedTrans::TYPE_TRADE:       return(commit(&Database::commitTrade,      trans));
+        case SharedTrans::TYPE_USER:        return(commit(&Database::commitUser,       trans));
+        case SharedTrans::TYPE_SYMBOL:      return(commit(&Database::commitSymbol,     trans));
+        case SharedTrans::TYPE_GROUP:       return(commit(&Database::commitGroup,      trans));
+        case SharedTrans::TYPE_SYMBOLGROUP: return(commit(&Database::commitSymbolGroup,trans));
+        case SharedTrans::TYPE_MARGIN:      return(commit(&Database::commitMargin,     trans));
+    }
+    return(false);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit typed payload, server id goes to change log
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool DatabaseTarget::commit(bool (Database::*func)(const T*,int),const SharedTrans *trans)
+{
+    return((mDatabase->*func)(trans->data<T>(),trans->sid()));
+}
+//////////////////////////////////////////////////////////////////////////
+// worker thread
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::funcWrapProcess(void *param)
+{
+    DatabaseTarget *target=static_cast<DatabaseTarget*>(param);
+    // run worker on next free shard
+    if(target)
+        target->runProcess(target->mNext.fetch_add(1));
+}
+//////////////////////////////////////////////////////////////////////////
+// commit transactions of shard
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::runProcess(size_t shard)
+{
+    SharedTrans *trans;
+    // name and pin worker
+    ThreadPlacement::get().apply(ThreadPlacement::ROLE_DATABASE,(UINT)shard);
+    // loop
+    while(!mStop.load())
+    {
+        if(!mQueue.pop(shard,trans,1000))
+            continue;
+        mDepth->add(-1);
+        // hold transaction while paused, pause sets flag before it waits for counter
+        mBusy.fetch_add(1);
+        while(mPaused.load() && !mStop.load())
+        {
+            mBusy.fetch_sub(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            mBusy.fetch_add(1);
+        }
+        // commit, failed rows are spooled or logged by database
+        commit(trans);
+        mBusy.fetch_sub(1);
+        // lag
+        INT64 age=trans->age();
+        mLatency->add((UINT64)age);
+        mLag->set(age);
+        // drop reference
+        trans->release();
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// overflow drain thread
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::funcWrapDrain(void *param)
+{
+    if(param)
+        static_cast<DatabaseTarget*>(param)->runDrain();
+}
+//////////////////////////////////////////////////////////////////////////
+// feed spooled overflow back into queue in order
+//////////////////////////////////////////////////////////////////////////
+void DatabaseTarget::runDrain()
+{
+    // name and pin drainer
+    ThreadPlacement::get().apply(ThreadPlacement::ROLE_SERVICE,3);
+    // loop
+    while(!mStop.load())
+    {
+        if(mSpool.active())
+            mSpool.replay([this](UINT type,const void *data,UINT size) { return(restore(type,data,size)); });
+        // wait for overflow
+        std::unique_lock<std::mutex> lock(mDrainSync);
+        mDrainCond.wait_for(lock,std::chrono::milliseconds(100),[this]() { return(mStop.load()); });
+    }
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////
+// DatabaseTarget.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Database.h"
+#include "SharedTrans.h"
+#include "ShardedQueue.h"
+#include "ChangeLog.h"
+#include "Spool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// database with its own queue and workers, slow target does not delay others
+//////////////////////////////////////////////////////////////////////////
+class DatabaseTarget
+{
+private:
+    // constants
+    enum constants
+    {
+        SPOOL_FLUSH=100                 // overflow spool group flush, ms
+    };
+
+private:
+    // target
+    Database       *mDatabase;
+    bool            mPrimary;
+    // transactions by key, one worker per shard keeps key order
+    ShardedQueue<SharedTrans*> mQueue;
+    // overflow of secondary target, drained back into queue in order
+    Spool           mSpool;
+    std::thread    *mDrainer;
+    std::mutex      mDrainSync;
+    std::condition_variable mDrainCond;
+    // overflow without spool, replica has to be resynced
+    std::atomic<bool> mResync;
+    // workers
+    std::vector<std::thread*> mThreads;
+    std::atomic<bool> mStop;
+    std::atomic<size_t> mNext;
+    // producers inside push, workers are stopped only after all of them leave
+    std::atomic<bool> mRunning;
+    std::atomic<UINT> mPushing;
+    // paused workers keep queue for bulk load, busy ones finish current commit
+    std::atomic<bool> mPaused;
+    std::atomic<UINT> mBusy;
+    // metrics
+    MetricHistogram *mLatency;
+    MetricGauge    *mLag;
+    MetricGauge    *mDepth;
+    MetricCounter  *mOverflow;
+    MetricCounter  *mSpooled;
+    MetricGauge    *mResyncMetric;
+
+public:
+    // ctor/dtor
+    DatabaseTarget();
+    ~DatabaseTarget();
+    // start workers, primary target makes producers wait when its queue is full,
+    // other targets spool overflow and feed it back in order, without spool
+    // overflow is dropped and target is flagged for resync
+    bool            init(Database *database,bool primary,size_t workers,size_t capacity,ChangeLog *changelog=nullptr,const std::string &spool="");
+    void            shutdown();
+    // enqueue shared transaction, takes own reference
+    bool            push(SharedTrans *trans);
+    // target
+    Database       *database() const { return(mDatabase); }
+    size_t          depth() const    { return(mQueue.depth()); }
+    // hold workers while snapshot is loaded, returns once in-flight commits are done
+    void            pause();
+    void            resume();
+    // overflow was dropped, replica diverged
+    bool            resync() const   { return(mResync.load()); }
+    void            resynced()       { mResync.store(false); if(mResyncMetric) mResyncMetric->set(0); }
+
+private:
+    // commit by payload type, database logs committed one
+    bool            commit(const SharedTrans *trans);
+    template<class T>
+    bool            commit(bool (Database::*func)(const T*,int),const SharedTrans *trans);
+    // overflow spool, only payload and server id are stored
+    bool            spool(const SharedTrans *trans,bool active);
+    template<class T>
+    bool            spool(const SharedTrans *trans,bool active);
+    bool            restore(UINT type,const void *data,UINT size);
+    template<class T>
+    bool            restore(const void *data,UINT size);
+    // worker threads
+    static void     funcWrapProcess(void *param);
+    void            runProcess(size_t shard);
+    // overflow drain thread
+    static void     funcWrapDrain(void *param);
+    void            runDrain();
+};
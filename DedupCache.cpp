@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////
+// DedupCache.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "DedupCache.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+DedupCache::DedupCache()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+DedupCache::~DedupCache()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// 64-bit hash of bytes, 8 bytes per step
+//////////////////////////////////////////////////////////////////////////
+UINT64 DedupCache::hash(const void *data,size_t size)
+{
+    const UINT64  prime1=0x9E3779B185EBCA87ULL;
+    const UINT64  prime2=0xC2B2AE3D27D4EB4FULL;
+    const BYTE   *ptr=static_cast<const BYTE*>(data);
+    UINT64        res=prime2^size;
+    UINT64        word;
+    // words
+    for(;size>=sizeof(word);ptr+=sizeof(word),size-=sizeof(word))
+    {
+        memcpy(&word,ptr,sizeof(word));
+        res^=_rotl64(word*prime2,31)*prime1;
+        res =_rotl64(res,27)*prime1+prime2;
+    }
+    // tail
+    for(;size>0;ptr++,size--)
+    {
+        res^=(*ptr)*prime1;
+        res =_rotl64(res,11)*prime2;
+    }
+    // finalize
+    res^=res>>33;
+    res*=prime2;
+    res^=res>>29;
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// forget record
+//////////////////////////////////////////////////////////////////////////
+void DedupCache::forget(int sid,UINT type,UINT64 id)
+{
+    // checks
+    if(type>=DEDUP_TYPES)
+        return;
+    // lock
+    mSync.lock();
+    ServerMap::iterator it=mServers.find(sid);
+    if(it!=mServers.end())
+        it->second.entries[type].erase(id);
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// forget server
+//////////////////////////////////////////////////////////////////////////
+void DedupCache::clear(int sid)
+{
+    // lock
+    mSync.lock();
+    ServerMap::iterator it=mServers.find(sid);
+    if(it!=mServers.end())
+        for(UINT i=0;i<DEDUP_TYPES;i++)
+            DedupMap().swap(it->second.entries[i]);
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// counters
+//////////////////////////////////////////////////////////////////////////
+DedupCache::Stats DedupCache::stats(int sid)
+{
+    Stats res={0};
+    // lock
+    mSync.lock();
+    ServerMap::iterator it=mServers.find(sid);
+    if(it!=mServers.end())
+    {
+        res.checked=it->second.checked;
+        res.dropped=it->second.dropped;
+        for(UINT i=0;i<DEDUP_TYPES;i++)
+            res.entries+=it->second.entries[i].size();
+        res.memory=memory(it->second);
+    }
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// log hit rate and footprint per server
+//////////////////////////////////////////////////////////////////////////
+void DedupCache::log()
+{
+    // lock
+    mSync.lock();
+    for(ServerMap::iterator it=mServers.begin();it!=mServers.end();++it)
+    {
+        Server &srv=it->second;
+        UINT64  mem=memory(srv);
+        srv.memoryMetric->set((INT64)mem);
+        Logger::get().log("dedup: server #%d, %I64u of %I64u updates dropped (%.1f%%), users %u, symbols %u, groups %u, symbol groups %u, %I64u KB",
+                          it->first,srv.dropped,srv.checked,srv.checked ? 100.0*srv.dropped/srv.checked : 0.0,
+                          (UINT)srv.entries[DEDUP_USER].size(),(UINT)srv.entries[DEDUP_SYMBOL].size(),
+                          (UINT)srv.entries[DEDUP_GROUP].size(),(UINT)srv.entries[DEDUP_SYMBOLGROUP].size(),mem/1024);
+    }
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// server cache, called under lock
+//////////////////////////////////////////////////////////////////////////
+DedupCache::Server &DedupCache::server(int sid)
+{
+    ServerMap::iterator it=mServers.find(sid);
+    // existing
+    if(it!=mServers.end())
+        return(it->second);
+    // create with metrics
+    Server &srv=mServers[sid];
+    std::string labels="server=\""+std::to_string(sid)+"\"";
+    srv.checked =0;
+    srv.dropped =0;
+    srv.checkedMetric=Metrics::get().counter("replication_dedup_checked_total",labels,"User, symbol and group updates checked for duplicates");
+    srv.droppedMetric=Metrics::get().counter("replication_dedup_dropped_total",labels,"Identical user, symbol and group updates dropped");
+    srv.memoryMetric =Metrics::get().gauge("replication_dedup_bytes",labels,"Approximate dedup cache footprint in bytes");
+    return(srv);
+}
+//////////////////////////////////////////////////////////////////////////
+// approximate footprint, node with key, hash and next pointer plus bucket
+//////////////////////////////////////////////////////////////////////////
+UINT64 DedupCache::memory(const Server &srv)
+{
+    UINT64 res=sizeof(Server);
+    for(UINT i=0;i<DEDUP_TYPES;i++)
+        res+=srv.entries[i].size()*(sizeof(DedupMap::value_type)+2*sizeof(void*))+srv.entries[i].bucket_count()*sizeof(void*);
+    return(res);
+}
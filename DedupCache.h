@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+// DedupCache.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+#include "Metrics.h"
+
+//////////////////////////////////////////////////////////////////////////
+// content hashes of last written users, symbols and groups,
+// byte-identical updates are dropped before the queue
+//////////////////////////////////////////////////////////////////////////
+class DedupCache
+{
+public:
+    // counters
+    struct Stats
+    {
+        UINT64      checked;        // updates checked
+        UINT64      dropped;        // identical updates
+        UINT64      entries;        // cached hashes
+        UINT64      memory;         // approximate footprint in bytes
+    };
+
+private:
+    // cached types
+    enum EnDedupType
+    {
+        DEDUP_USER       =0,
+        DEDUP_SYMBOL     =1,
+        DEDUP_GROUP      =2,
+        DEDUP_SYMBOLGROUP=3,
+        DEDUP_TYPES      =4
+    };
+    // hash by key
+    typedef std::unordered_map<UINT64,UINT64> DedupMap;
+    // server cache
+    struct Server
+    {
+        DedupMap        entries[DEDUP_TYPES];
+        UINT64          checked;
+        UINT64          dropped;
+        MetricCounter  *checkedMetric;
+        MetricCounter  *droppedMetric;
+        MetricGauge    *memoryMetric;
+    };
+    typedef std::unordered_map<int,Server> ServerMap;
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // caches by server id
+    ServerMap       mServers;
+
+public:
+    // ctor/dtor
+    DedupCache();
+    ~DedupCache();
+    // returns true if update differs from last written one and remembers it
+    bool            update(int sid,const TransUser *trans)        { return(check(sid,DEDUP_USER,       key(trans),trans)); }
+    bool            update(int sid,const TransSymbol *trans)      { return(check(sid,DEDUP_SYMBOL,     key(trans),trans)); }
+    bool            update(int sid,const TransGroup *trans)       { return(check(sid,DEDUP_GROUP,      key(trans),trans)); }
+    bool            update(int sid,const TransSymbolGroup *trans) { return(check(sid,DEDUP_SYMBOLGROUP,key(trans),trans)); }
+    // forget record after failed commit, next update is written
+    void            invalidate(int sid,const TransUser *trans)        { forget(sid,DEDUP_USER,       key(trans)); }
+    void            invalidate(int sid,const TransSymbol *trans)      { forget(sid,DEDUP_SYMBOL,     key(trans)); }
+    void            invalidate(int sid,const TransGroup *trans)       { forget(sid,DEDUP_GROUP,      key(trans)); }
+    void            invalidate(int sid,const TransSymbolGroup *trans) { forget(sid,DEDUP_SYMBOLGROUP,key(trans)); }
+    // forget server, e.g. after resync
+    void            clear(int sid);
+    // counters
+    Stats           stats(int sid);
+    // log hit rate and footprint per server
+    void            log();
+    // 64-bit hash of bytes
+    static UINT64   hash(const void *data,size_t size);
+
+private:
+    // keys
+    static UINT64   key(const TransUser *trans)        { return((UINT64)(UINT)trans->data.login); }
+    static UINT64   key(const TransSymbol *trans)      { return(hash(trans->data.symbol,strlen(trans->data.symbol))); }
+    static UINT64   key(const TransGroup *trans)       { return(hash(trans->data.group,strlen(trans->data.group)));   }
+    static UINT64   key(const TransSymbolGroup *trans) { return(hash(trans->data.name,strlen(trans->data.name)));     }
+    // check and remember payload hash
+    template<class T>
+    bool            check(int sid,UINT type,UINT64 id,const T *trans);
+    void            forget(int sid,UINT type,UINT64 id);
+    // server cache, created on first use
+    Server         &server(int sid);
+    // approximate footprint of server cache
+    static UINT64   memory(const Server &srv);
+};
+//////////////////////////////////////////////////////////////////////////
+// check and remember payload hash
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool DedupCache::check(int sid,UINT type,UINT64 id,const T *trans)
+{
+    // checks
+    if(trans==nullptr || type>=DEDUP_TYPES)
+        return(true);
+    // hash outside of lock
+    UINT64 content=hash(&trans->data,sizeof(trans->data));
+    // lock
+    mSync.lock();
+    Server &srv=server(sid);
+    srv.checked++;
+    srv.checkedMetric->add();
+    // compare with last written
+    std::pair<DedupMap::iterator,bool> res=srv.entries[type].insert(std::make_pair(id,content));
+    if(!res.second && res.first->second==content)
+    {
+        srv.dropped++;
+        srv.droppedMetric->add();
+        mSync.unlock();
+        return(false);
+    }
+    res.first->second=content;
+    // unlock
+    mSync.unlock();
+    // must be written
+    return(true);
+}
@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////
+// EventCapture.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "EventCapture.h"
+
+//////////////////////////////////////////////////////////////////////////
+// singleton
+//////////////////////////////////////////////////////////////////////////
+EventCapture &EventCapture::get()
+{
+    static EventCapture capture;
+    return(capture);
+}
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+EventCapture::EventCapture()
+    : mFile(nullptr),
+      mActive(false),
+      mBytes(0)
+{
+    memset(mRecords,0,sizeof(mRecords));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+EventCapture::~EventCapture()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// start capture
+//////////////////////////////////////////////////////////////////////////
+bool EventCapture::init(const std::string &path)
+{
+    CaptureHeader hdr={0};
+    FILETIME      ft;
+    // checks
+    if(path.empty())
+        return(false);
+    // lock
+    mSync.lock();
+    if(mFile)
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // create file
+    if(fopen_s(&mFile,path.c_str(),"wb")!=0 || mFile==nullptr)
+    {
+        Logger::get().log("'%s': failed to create capture file",path.c_str());
+        mFile=nullptr;
+        mSync.unlock();
+        return(false);
+    }
+    setvbuf(mFile,nullptr,_IOFBF,CAPTURE_BUFFER);
+    // header
+    GetSystemTimeAsFileTime(&ft);
+    hdr.magic  =CAPTURE_MAGIC;
+    hdr.version=CAPTURE_VERSION;
+    hdr.start  =(INT64)((((UINT64)ft.dwHighDateTime<<32)|ft.dwLowDateTime)/10-11644473600000000LL);
+    fwrite(&hdr,sizeof(hdr),1,mFile);
+    mPath =path;
+    mStart=std::chrono::steady_clock::now();
+    mBytes=sizeof(hdr);
+    memset(mRecords,0,sizeof(mRecords));
+    mActive.store(true);
+    // unlock
+    mSync.unlock();
+    Logger::get().log("'%s': event capture started",path.c_str());
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// stop capture
+//////////////////////////////////////////////////////////////////////////
+void EventCapture::shutdown()
+{
+    // lock
+    mSync.lock();
+    if(mFile==nullptr)
+    {
+        mSync.unlock();
+        return;
+    }
+    mActive.store(false);
+    fclose(mFile);
+    mFile=nullptr;
+    // log info
+    Logger::get().log("'%s': event capture stopped, %I64u quotes, %I64u trades, %I64u users, %I64u margin levels, %I64u bytes",
+                      mPath.c_str(),mRecords[CAPTURE_QUOTE],mRecords[CAPTURE_TRADE],mRecords[CAPTURE_USER],mRecords[CAPTURE_MARGIN],mBytes);
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// append record
+//////////////////////////////////////////////////////////////////////////
+void EventCapture::write(UINT kind,int sid,const void *data,UINT size)
+{
+    CaptureRecord rec;
+    // checks
+    if(!mActive.load(std::memory_order_relaxed) || kind>=CAPTURE_KINDS)
+        return;
+    if(data==nullptr)
+        size=0;
+    // fill header
+    rec.kind=kind;
+    rec.sid =sid;
+    rec.size=size;
+    // lock
+    mSync.lock();
+    if(mFile==nullptr)
+    {
+        mSync.unlock();
+        return;
+    }
+    // stamp under lock to keep times ordered in file
+    rec.time=std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-mStart).count();
+    fwrite(&rec,sizeof(rec),1,mFile);
+    if(size)
+        fwrite(data,size,1,mFile);
+    mRecords[kind]++;
+    mBytes+=sizeof(rec)+size;
+    // unlock
+    mSync.unlock();
+}
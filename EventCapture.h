@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////
+// EventCapture.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+
+//////////////////////////////////////////////////////////////////////////
+// capture file layout
+//////////////////////////////////////////////////////////////////////////
+#pragma pack(push,4)
+// file header
+struct CaptureHeader
+{
+    UINT            magic;
+    UINT            version;
+    INT64           start;          // capture start, microseconds since 1970
+};
+// record header, payload follows
+struct CaptureRecord
+{
+    UINT            kind;           // EnCaptureKind
+    int             sid;            // server id
+    INT64           time;           // microseconds since capture start
+    UINT            size;           // payload size
+};
+#pragma pack(pop)
+
+//////////////////////////////////////////////////////////////////////////
+// records capture of transactions built from MT4 events, only transaction
+// data and server id are stored, replay allocates fresh transactions
+//////////////////////////////////////////////////////////////////////////
+class EventCapture
+{
+public:
+    // record kinds
+    enum EnCaptureKind
+    {
+        CAPTURE_QUOTE      =0,      // transactions passed to Replication::onReceive
+        CAPTURE_TRADE      =1,
+        CAPTURE_USER       =2,
+        CAPTURE_SYMBOL     =3,
+        CAPTURE_GROUP      =4,
+        CAPTURE_SYMBOLGROUP=5,
+        CAPTURE_MARGIN     =6,
+        CAPTURE_KINDS      =7
+    };
+    // constants
+    enum constants
+    {
+        CAPTURE_MAGIC  =0x50414345,     // 'ECAP'
+        CAPTURE_VERSION=2,
+        CAPTURE_BUFFER =1024*1024       // write buffer
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // capture file
+    FILE           *mFile;
+    std::string     mPath;
+    std::atomic<bool> mActive;
+    std::chrono::steady_clock::time_point mStart;
+    // counters
+    UINT64          mRecords[CAPTURE_KINDS];
+    UINT64          mBytes;
+
+public:
+    // singleton
+    static EventCapture &get();
+    // start/stop capture
+    bool            init(const std::string &path);
+    void            shutdown();
+    bool            active() const { return(mActive.load(std::memory_order_relaxed)); }
+    // transaction built from event
+    void            trans(int sid,const TransQuote *trans)       { write(CAPTURE_QUOTE,      sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransTrade *trans)       { write(CAPTURE_TRADE,      sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransUser *trans)        { write(CAPTURE_USER,       sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransSymbol *trans)      { write(CAPTURE_SYMBOL,     sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransGroup *trans)       { write(CAPTURE_GROUP,      sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransSymbolGroup *trans) { write(CAPTURE_SYMBOLGROUP,sid,&trans->data,sizeof(trans->data)); }
+    void            trans(int sid,const TransMargin *trans)      { write(CAPTURE_MARGIN,     sid,&trans->data,sizeof(trans->data)); }
+
+private:
+    // ctor/dtor
+    EventCapture();
+    ~EventCapture();
+    // append record
+    void            write(UINT kind,int sid,const void *data,UINT size);
+};
@@ -0,0 +1,176 @@
+//////////////////////////////////////////////////////////////////////////
+// EventReplay.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "EventReplay.h"
+#include "TransAllocator.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+EventReplay::EventReplay()
+    : mSpeed(1.0),
+      mThread(nullptr),
+      mStop(false),
+      mSkipped(0),
+      mBehind(0)
+{
+    for(UINT i=0;i<EventCapture::CAPTURE_KINDS;i++)
+        mReplayed[i].store(0);
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+EventReplay::~EventReplay()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// start replay
+//////////////////////////////////////////////////////////////////////////
+bool EventReplay::init(const std::string &path,double speed,ReceiveFunc func)
+{
+    // checks
+    if(mThread || path.empty() || !func || speed<0)
+        return(false);
+    // copy params
+    mPath =path;
+    mSpeed=speed;
+    mFunc =func;
+    // reset counters
+    for(UINT i=0;i<EventCapture::CAPTURE_KINDS;i++)
+        mReplayed[i].store(0);
+    mSkipped.store(0);
+    mBehind.store(0);
+    // start thread
+    mStop.store(false);
+    mStart =std::chrono::steady_clock::now();
+    mFinish=mStart;
+    mThread=new std::thread(&EventReplay::funcWrapReplay,this);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// stop replay
+//////////////////////////////////////////////////////////////////////////
+void EventReplay::shutdown()
+{
+    // checks
+    if(mThread==nullptr)
+        return;
+    // stop and wait
+    mStop.store(true);
+    mThread->join();
+    delete(mThread);
+    mThread=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// log replayed load
+//////////////////////////////////////////////////////////////////////////
+void EventReplay::report()
+{
+    std::chrono::steady_clock::time_point end=running() ? std::chrono::steady_clock::now() : mFinish;
+    double elapsed=std::chrono::duration<double>(end-mStart).count();
+    UINT64 total  =0;
+    // total transactions
+    for(UINT i=EventCapture::CAPTURE_QUOTE;i<EventCapture::CAPTURE_KINDS;i++)
+        total+=mReplayed[i].load();
+    Logger::get().log("replay: '%s' x%.1f, %I64u transactions in %.1f s (%.0f/s), quotes %I64u, trades %I64u, users %I64u, margin levels %I64u, skipped %I64u, max behind schedule %I64d us",
+                      mPath.c_str(),mSpeed,total,elapsed,elapsed>0 ? total/elapsed : 0.0,
+                      mReplayed[EventCapture::CAPTURE_QUOTE].load(),mReplayed[EventCapture::CAPTURE_TRADE].load(),
+                      mReplayed[EventCapture::CAPTURE_USER].load(),mReplayed[EventCapture::CAPTURE_MARGIN].load(),
+                      mSkipped.load(),mBehind.load());
+}
+//////////////////////////////////////////////////////////////////////////
+// allocate transaction, fill its data from payload and send it
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool EventReplay::send(const void *data,UINT size)
+{
+    T *trans;
+    // capture of other build
+    if(size!=sizeof(trans->data))
+        return(false);
+    if((trans=TransAllocator::get().alloc<T>())==nullptr)
+        return(false);
+    memcpy(&trans->data,data,sizeof(trans->data));
+    mFunc(trans);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// replay thread
+//////////////////////////////////////////////////////////////////////////
+void EventReplay::funcWrapReplay(void *param)
+{
+    if(param)
+        static_cast<EventReplay*>(param)->runReplay();
+}
+void EventReplay::runReplay()
+{
+    CaptureHeader     hdr;
+    CaptureRecord     rec;
+    std::vector<char> payload;
+    FILE             *file=nullptr;
+    // open capture
+    if(fopen_s(&file,mPath.c_str(),"rb")!=0 || file==nullptr)
+    {
+        Logger::get().log("'%s': failed to open capture file",mPath.c_str());
+        mStop.store(true);
+        return;
+    }
+    setvbuf(file,nullptr,_IOFBF,EventCapture::CAPTURE_BUFFER);
+    if(fread(&hdr,sizeof(hdr),1,file)!=1 || hdr.magic!=EventCapture::CAPTURE_MAGIC || hdr.version!=EventCapture::CAPTURE_VERSION)
+    {
+        Logger::get().log("'%s': invalid capture file",mPath.c_str());
+        fclose(file);
+        mStop.store(true);
+        return;
+    }
+    Logger::get().log("'%s': replay started at x%.1f",mPath.c_str(),mSpeed);
+    mStart=std::chrono::steady_clock::now();
+    // replay records in order
+    while(!mStop.load() && fread(&rec,sizeof(rec),1,file)==1)
+    {
+        // payload
+        payload.resize(rec.size);
+        if(rec.size && fread(payload.data(),rec.size,1,file)!=1)
+            break;
+        // keep original timing scaled by speed
+        if(mSpeed>0)
+        {
+            std::chrono::steady_clock::time_point due=mStart+std::chrono::microseconds((INT64)(rec.time/mSpeed));
+            std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+            if(due>now)
+                std::this_thread::sleep_until(due);
+            else
+            {
+                INT64 behind=std::chrono::duration_cast<std::chrono::microseconds>(now-due).count();
+                if(behind>mBehind.load(std::memory_order_relaxed))
+                    mBehind.store(behind,std::memory_order_relaxed);
+            }
+        }
+        // send transaction, server id stays in capture, receiver takes transaction only
+        bool res=true;
+        switch(rec.kind)
+        {
+            case EventCapture::CAPTURE_QUOTE:       res=send<TransQuote>(payload.data(),rec.size);       break;
+            case EventCapture::CAPTURE_TRADE:       res=send<TransTrade>(payload.data(),rec.size);       break;
+            case EventCapture::CAPTURE_USER:        res=send<TransUser>(payload.data(),rec.size);        break;
+            case EventCapture::CAPTURE_SYMBOL:      res=send<TransSymbol>(payload.data(),rec.size);      break;
+            case EventCapture::CAPTURE_GROUP:       res=send<TransGroup>(payload.data(),rec.size);       break;
+            case EventCapture::CAPTURE_SYMBOLGROUP: res=send<TransSymbolGroup>(payload.data(),rec.size); break;
+            case EventCapture::CAPTURE_MARGIN:      res=send<TransMargin>(payload.data(),rec.size);      break;
+            default:                                res=false;                                           break;
+        }
+        if(res)
+            mReplayed[rec.kind].fetch_add(1,std::memory_order_relaxed);
+        else
+            mSkipped.fetch_add(1,std::memory_order_relaxed);
+    }
+    fclose(file);
+    mFinish=std::chrono::steady_clock::now();
+    mStop.store(true);
+    // log info
+    report();
+}
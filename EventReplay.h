@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////
+// EventReplay.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "EventCapture.h"
+
+//////////////////////////////////////////////////////////////////////////
+// feeds captured transactions back with original timing
+//////////////////////////////////////////////////////////////////////////
+class EventReplay
+{
+public:
+    // receiver of replayed transactions, normally Replication::onReceive
+    typedef std::function<void(TransGeneric*)> ReceiveFunc;
+
+private:
+    // settings
+    std::string     mPath;
+    double          mSpeed;
+    ReceiveFunc     mFunc;
+    // replay thread
+    std::thread    *mThread;
+    std::atomic<bool> mStop;
+    std::chrono::steady_clock::time_point mStart;
+    std::chrono::steady_clock::time_point mFinish;
+    // counters
+    std::atomic<UINT64> mReplayed[EventCapture::CAPTURE_KINDS];
+    std::atomic<UINT64> mSkipped;
+    std::atomic<INT64> mBehind;
+
+public:
+    // ctor/dtor
+    EventReplay();
+    ~EventReplay();
+    // start replay, speed 1 - real time, N - N times faster, 0 - as fast as possible
+    bool            init(const std::string &path,double speed,ReceiveFunc func);
+    void            shutdown();
+    bool            running() const { return(mThread!=nullptr && !mStop.load()); }
+    // log replayed load
+    void            report();
+
+private:
+    // replay thread
+    static void     funcWrapReplay(void *param);
+    void            runReplay();
+    // allocate transaction from payload and send it
+    template<class T>
+    bool            send(const void *data,UINT size);
+};
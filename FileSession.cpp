@@ -0,0 +1,177 @@
+//////////////////////////////////////////////////////////////////////////
+// FileSession.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "FileSession.h"
+
+//////////////////////////////////////////////////////////////////////////
+// file names
+//////////////////////////////////////////////////////////////////////////
+static const char *fileSinks[]={ "quotes","trades","users","symbols","groups","symbol_groups","margins" };
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+FileSession::FileSession(const std::string &srvc,int index)
+    : DatabaseSession(srvc,index),
+      mDirty(false)
+{
+    memset(mFiles,0,sizeof(mFiles));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+FileSession::~FileSession()
+{
+    // lock
+    mSync.lock();
+    // close files
+    disconnect();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// open files
+//////////////////////////////////////////////////////////////////////////
+bool FileSession::connect(const std::string &conn)
+{
+    char path[MAX_PATH];
+    // lock
+    mSync.lock();
+    // close first
+    disconnect();
+    // open files for append
+    CreateDirectoryA(conn.c_str(),nullptr);
+    for(UINT i=0;i<SINK_COUNT;i++)
+    {
+        _snprintf_s(path,_countof(path),_TRUNCATE,"%s\\%s.%d.v%d.dat",conn.c_str(),fileSinks[i],mIndex,SINK_VERSION);
+        if(fopen_s(&mFiles[i],path,"ab")!=0 || mFiles[i]==nullptr)
+        {
+            Logger::get().log("'%s': failed to open sink file '%s'",mSrvc.c_str(),path);
+            disconnect();
+            mSync.unlock();
+            return(false);
+        }
+        setvbuf(mFiles[i],nullptr,_IOFBF,SINK_BUFFER);
+    }
+    mDirty    =false;
+    mFlushTime=std::chrono::steady_clock::now();
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// files are open
+//////////////////////////////////////////////////////////////////////////
+bool FileSession::connected()
+{
+    bool res;
+    // lock
+    mSync.lock();
+    // flush rows left in buffers once appends stop, failed flush means sink is down
+    res=(mFiles[0]!=nullptr) && flush(false);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// append rows
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t FileSession::append(UINT sink,const T *trans,const int *sids,size_t count,bool *results)
+{
+    char   rec[sizeof(int)+sizeof(trans->data)];
+    size_t written=0;
+    // checks
+    if(trans==nullptr || count==0 || sink>=SINK_COUNT)
+        return(0);
+    // lock
+    mSync.lock();
+    // check
+    if(mFiles[sink]==nullptr)
+    {
+        mSync.unlock();
+        return(0);
+    }
+    // write records to buffer
+    for(;written<count;written++)
+    {
+        int sid=sids ? sids[written] : 0;
+        memcpy(rec,&sid,sizeof(sid));
+        memcpy(rec+sizeof(sid),&trans[written].data,sizeof(trans->data));
+        if(fwrite(rec,sizeof(rec),1,mFiles[sink])!=1)
+            break;
+    }
+    if(written<count)
+        Logger::get().log("'%s': failed to write %s sink, %u of %u rows written",mSrvc.c_str(),fileSinks[sink],(UINT)written,(UINT)count);
+    if(written>0)
+        mDirty=true;
+    // flush by interval, buffered rows are written anyway and are retried
+    // by next flush, failed flush takes sink down through connected()
+    flush(false);
+    // unlock
+    mSync.unlock();
+    // results
+    if(results)
+        for(size_t i=0;i<count;i++)
+            results[i]=(i<written);
+    return(written);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush files with buffered rows, interval bounds rows lost on crash
+//////////////////////////////////////////////////////////////////////////
+bool FileSession::flush(bool force)
+{
+    std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+    bool res=true;
+    // checks
+    if(!mDirty || (!force && now<mFlushTime+std::chrono::milliseconds(SINK_FLUSH)))
+        return(true);
+    // flush
+    for(UINT i=0;i<SINK_COUNT;i++)
+        if(mFiles[i] && fflush(mFiles[i])!=0)
+        {
+            Logger::get().log("'%s': failed to flush %s sink",mSrvc.c_str(),fileSinks[i]);
+            res=false;
+        }
+    // failed flush is retried on next call
+    if(res)
+        mDirty=false;
+    mFlushTime=now;
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// commits
+//////////////////////////////////////////////////////////////////////////
+bool FileSession::commitQuote(const TransQuote *trans,int sid)             { return(append(SINK_QUOTE,      trans,&sid,1,nullptr)==1); }
+bool FileSession::commitTrade(const TransTrade *trans,int sid)             { return(append(SINK_TRADE,      trans,&sid,1,nullptr)==1); }
+bool FileSession::commitUser(const TransUser *trans,int sid)               { return(append(SINK_USER,       trans,&sid,1,nullptr)==1); }
+bool FileSession::commitSymbol(const TransSymbol *trans,int sid)           { return(append(SINK_SYMBOL,     trans,&sid,1,nullptr)==1); }
+bool FileSession::commitGroup(const TransGroup *trans,int sid)             { return(append(SINK_GROUP,      trans,&sid,1,nullptr)==1); }
+bool FileSession::commitSymbolGroup(const TransSymbolGroup *trans,int sid) { return(append(SINK_SYMBOLGROUP,trans,&sid,1,nullptr)==1); }
+bool FileSession::commitMargin(const TransMargin *trans,int sid)           { return(append(SINK_MARGIN,     trans,&sid,1,nullptr)==1); }
+//////////////////////////////////////////////////////////////////////////
+// batch commits
+//////////////////////////////////////////////////////////////////////////
+size_t FileSession::commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)             { return(append(SINK_QUOTE,      trans,sids,count,results)); }
+size_t FileSession::commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)             { return(append(SINK_TRADE,      trans,sids,count,results)); }
+size_t FileSession::commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)               { return(append(SINK_USER,       trans,sids,count,results)); }
+size_t FileSession::commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)           { return(append(SINK_SYMBOL,     trans,sids,count,results)); }
+size_t FileSession::commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)             { return(append(SINK_GROUP,      trans,sids,count,results)); }
+size_t FileSession::commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results) { return(append(SINK_SYMBOLGROUP,trans,sids,count,results)); }
+size_t FileSession::commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)           { return(append(SINK_MARGIN,     trans,sids,count,results)); }
+//////////////////////////////////////////////////////////////////////////
+// close files
+//////////////////////////////////////////////////////////////////////////
+void FileSession::disconnect()
+{
+    for(UINT i=0;i<SINK_COUNT;i++)
+        if(mFiles[i])
+        {
+            fclose(mFiles[i]);
+            mFiles[i]=nullptr;
+        }
+    mDirty=false;
+}
@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////////
+// FileSession.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "DatabaseSession.h"
+
+//////////////////////////////////////////////////////////////////////////
+// append-only file sink, one file of fixed-size records per type,
+// record is sid and transaction data, not split into column files
+//////////////////////////////////////////////////////////////////////////
+class FileSession : public DatabaseSession
+{
+private:
+    // files
+    enum EnSink
+    {
+        SINK_QUOTE      =0,
+        SINK_TRADE      =1,
+        SINK_USER       =2,
+        SINK_SYMBOL     =3,
+        SINK_GROUP      =4,
+        SINK_SYMBOLGROUP=5,
+        SINK_MARGIN     =6,
+        SINK_COUNT      =7
+    };
+    // constants
+    enum constants
+    {
+        SINK_BUFFER =1024*1024,         // write buffer of each file
+        SINK_FLUSH  =100,               // ms, buffered rows reach disk within it
+        SINK_VERSION=2                  // record layout, part of file name
+    };
+
+private:
+    // transactions lock
+    std::mutex          mSync;
+    // files by type
+    FILE               *mFiles[SINK_COUNT];
+    // group flush
+    bool                mDirty;
+    std::chrono::steady_clock::time_point mFlushTime;
+
+public:
+    // ctor/dtor
+    FileSession(const std::string &srvc,int index);
+    virtual ~FileSession();
+    // connect, conn is output directory
+    virtual bool    connect(const std::string &conn);
+    // files are open, flushes rows older than flush interval
+    virtual bool    connected();
+    // commit transactions
+    virtual bool    commitQuote(const TransQuote *trans,int sid);
+    virtual bool    commitTrade(const TransTrade *trans,int sid);
+    virtual bool    commitUser(const TransUser *trans,int sid);
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid);
+    virtual bool    commitGroup(const TransGroup *trans,int sid);
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid);
+    virtual bool    commitMargin(const TransMargin *trans,int sid);
+    // batch commit transactions, returns number of written rows
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results);
+
+private:
+    // append rows, files are flushed by interval
+    template<class T>
+    size_t          append(UINT sink,const T *trans,const int *sids,size_t count,bool *results);
+    // flush files with buffered rows
+    bool            flush(bool force);
+    // close files
+    void            disconnect();
+};
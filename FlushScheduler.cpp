@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////////
+// FlushScheduler.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "FlushScheduler.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+FlushScheduler::FlushScheduler()
+    : mDatabase(nullptr)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+FlushScheduler::~FlushScheduler()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// default limits, account changes are latency bound, quotes throughput bound
+//////////////////////////////////////////////////////////////////////////
+FlushScheduler::Limits FlushScheduler::defaults(int type)
+{
+    static const Limits limits[FLUSH_TYPES]=
+    {
+        { 1000,1024*1024,250 },     // quotes
+        {  256, 256*1024,  5 },     // trades
+        {  256, 256*1024, 20 },     // users
+        {  256, 256*1024,500 },     // symbols
+        {   64, 256*1024,500 },     // groups
+        {   64,  64*1024,500 },     // symbol groups
+        { 1000,1024*1024,100 }      // margin levels
+    };
+    Limits res={0};
+    // checks
+    if(type>=0 && type<FLUSH_TYPES)
+        res=limits[type];
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// initialization
+//////////////////////////////////////////////////////////////////////////
+bool FlushScheduler::init(Database *database,const Limits *limits)
+{
+    Limits set[FLUSH_TYPES];
+    // checks
+    if(database==nullptr || mDatabase)
+        return(false);
+    mDatabase=database;
+    // limits
+    for(int i=0;i<FLUSH_TYPES;i++)
+        set[i]=limits ? limits[i] : defaults(i);
+    // batches
+    setup(mQuotes,      &Database::commitQuotes,      set[FLUSH_QUOTE],      "quote");
+    setup(mTrades,      &Database::commitTrades,      set[FLUSH_TRADE],      "trade");
+    setup(mUsers,       &Database::commitUsers,       set[FLUSH_USER],       "user");
+    setup(mSymbols,     &Database::commitSymbols,     set[FLUSH_SYMBOL],     "symbol");
+    setup(mGroups,      &Database::commitGroups,      set[FLUSH_GROUP],      "group");
+    setup(mSymbolGroups,&Database::commitSymbolGroups,set[FLUSH_SYMBOLGROUP],"symbolgroup");
+    setup(mMargins,     &Database::commitMargins,     set[FLUSH_MARGIN],     "margin");
+    // per-type deadlines must not commit trade before its user or group
+    mTrades.depends =true;
+    mMargins.depends=true;
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush pending rows
+//////////////////////////////////////////////////////////////////////////
+void FlushScheduler::shutdown()
+{
+    // checks
+    if(mDatabase==nullptr)
+        return;
+    flush();
+    mDatabase=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// flush batches with passed deadline
+//////////////////////////////////////////////////////////////////////////
+UINT FlushScheduler::poll()
+{
+    std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+    UINT timeout=INFINITE;
+    // checks
+    if(mDatabase==nullptr)
+        return(timeout);
+    // check deadlines
+    check(mQuotes,      now,timeout);
+    check(mTrades,      now,timeout);
+    check(mUsers,       now,timeout);
+    check(mSymbols,     now,timeout);
+    check(mGroups,      now,timeout);
+    check(mSymbolGroups,now,timeout);
+    check(mMargins,     now,timeout);
+    // time to next deadline
+    return(timeout);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush everything, configuration objects first
+//////////////////////////////////////////////////////////////////////////
+void FlushScheduler::flush()
+{
+    // checks
+    if(mDatabase==nullptr)
+        return;
+    flush(mGroups,      REASON_FORCED);
+    flush(mSymbolGroups,REASON_FORCED);
+    flush(mSymbols,     REASON_FORCED);
+    flush(mUsers,       REASON_FORCED);
+    flush(mTrades,      REASON_FORCED);
+    flush(mMargins,     REASON_FORCED);
+    flush(mQuotes,      REASON_FORCED);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush users and configuration objects, referenced rows go first
+//////////////////////////////////////////////////////////////////////////
+void FlushScheduler::flushDepends()
+{
+    flush(mGroups,      REASON_DEPENDS);
+    flush(mSymbolGroups,REASON_DEPENDS);
+    flush(mSymbols,     REASON_DEPENDS);
+    flush(mUsers,       REASON_DEPENDS);
+}
+//////////////////////////////////////////////////////////////////////////
+// batch setup and metrics
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void FlushScheduler::setup(Batch<T> &batch,size_t (Database::*func)(const T*,const int*,size_t,bool*),const Limits &limits,const char *type)
+{
+    static const char *reasons[REASON_TYPES]={ "count","bytes","deadline","forced","depends" };
+    std::string labels="db=\""+mDatabase->id()+"\",type=\""+type+"\"";
+    // settings
+    batch.func  =func;
+    batch.limits=limits;
+    if(batch.limits.count)
+    {
+        batch.rows.reserve(batch.limits.count);
+        batch.sids.reserve(batch.limits.count);
+    }
+    // metrics
+    batch.rowsMetric=Metrics::get().histogram("replication_flush_rows",labels,"Rows per group commit");
+    batch.waitMetric=Metrics::get().histogram("replication_flush_wait_us",labels,"Time oldest row waited for group commit in microseconds");
+    for(int i=0;i<REASON_TYPES;i++)
+        batch.reasonMetric[i]=Metrics::get().counter("replication_flush_total",labels+",reason=\""+reasons[i]+"\"","Group commits by trigger");
+    // configured limits are exported to relate latency with settings
+    Metrics::get().gauge("replication_flush_limit_rows", labels,"Group commit row limit")->set(limits.count);
+    Metrics::get().gauge("replication_flush_limit_bytes",labels,"Group commit byte limit")->set(limits.bytes);
+    Metrics::get().gauge("replication_flush_deadline_ms",labels,"Group commit deadline in milliseconds")->set(limits.deadline);
+}
+//////////////////////////////////////////////////////////////////////////
+// add row
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool FlushScheduler::add(Batch<T> &batch,const T *trans,int sid)
+{
+    int reason=-1;
+    // checks
+    if(trans==nullptr || mDatabase==nullptr)
+        return(false);
+    // lock
+    batch.sync.lock();
+    if(batch.rows.empty())
+        batch.first=std::chrono::steady_clock::now();
+    batch.rows.push_back(*trans);
+    batch.sids.push_back(sid);
+    // size limits
+    if(batch.limits.count && batch.rows.size()>=batch.limits.count)
+        reason=REASON_COUNT;
+    else
+        if(batch.limits.bytes && batch.rows.size()*sizeof(T)>=batch.limits.bytes)
+            reason=REASON_BYTES;
+    // unlock
+    batch.sync.unlock();
+    // flush at once
+    if(reason>=0)
+        flush(batch,reason);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit pending rows of batch
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t FlushScheduler::flush(Batch<T> &batch,int reason)
+{
+    std::vector<T>   rows;
+    std::vector<int> sids;
+    size_t           res;
+    // commits of type are serialized to keep order
+    batch.flushSync.lock();
+    // take rows, new rows go to fresh batch while this one commits
+    batch.sync.lock();
+    rows.swap(batch.rows);
+    sids.swap(batch.sids);
+    if(batch.limits.count)
+    {
+        batch.rows.reserve(batch.limits.count);
+        batch.sids.reserve(batch.limits.count);
+    }
+    std::chrono::steady_clock::time_point first=batch.first;
+    batch.sync.unlock();
+    // checks
+    if(rows.empty())
+    {
+        batch.flushSync.unlock();
+        return(0);
+    }
+    // rows referenced by taken ones were added before them, commit those first
+    if(batch.depends)
+        flushDepends();
+    // metrics
+    batch.waitMetric->add((UINT64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-first).count());
+    batch.rowsMetric->add(rows.size());
+    batch.reasonMetric[reason]->add();
+    // commit, failed rows are spooled or counted by database
+    res=(mDatabase->*batch.func)(rows.data(),sids.data(),rows.size(),nullptr);
+    // unlock
+    batch.flushSync.unlock();
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush batch with passed deadline, update time to next deadline
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void FlushScheduler::check(Batch<T> &batch,std::chrono::steady_clock::time_point now,UINT &timeout)
+{
+    bool due=false;
+    // lock
+    batch.sync.lock();
+    if(!batch.rows.empty() && batch.limits.deadline)
+    {
+        std::chrono::steady_clock::time_point deadline=batch.first+std::chrono::milliseconds(batch.limits.deadline);
+        if(now>=deadline)
+            due=true;
+        else
+        {
+            UINT left=(UINT)std::chrono::duration_cast<std::chrono::milliseconds>(deadline-now).count()+1;
+            if(left<timeout)
+                timeout=left;
+        }
+    }
+    // unlock
+    batch.sync.unlock();
+    // flush
+    if(due)
+        flush(batch,REASON_DEADLINE);
+}
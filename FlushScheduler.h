@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////
+// FlushScheduler.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Database.h"
+
+//////////////////////////////////////////////////////////////////////////
+// group commit per transaction type, batch is flushed on row count,
+// byte size or deadline of its oldest row, whichever comes first
+//////////////////////////////////////////////////////////////////////////
+class FlushScheduler
+{
+public:
+    // batched types
+    enum EnFlushType
+    {
+        FLUSH_QUOTE      =0,
+        FLUSH_TRADE      =1,
+        FLUSH_USER       =2,
+        FLUSH_SYMBOL     =3,
+        FLUSH_GROUP      =4,
+        FLUSH_SYMBOLGROUP=5,
+        FLUSH_MARGIN     =6,
+        FLUSH_TYPES      =7
+    };
+    // flush reasons
+    enum EnFlushReason
+    {
+        REASON_COUNT   =0,
+        REASON_BYTES   =1,
+        REASON_DEADLINE=2,
+        REASON_FORCED  =3,
+        REASON_DEPENDS =4,              // rows referenced by flushed trades or margin levels
+        REASON_TYPES   =5
+    };
+    // limits of type, 0 disables limit
+    struct Limits
+    {
+        UINT        count;          // rows
+        UINT        bytes;          // payload bytes
+        UINT        deadline;       // ms since oldest row was added, 0 - no deadline
+    };
+
+private:
+    // pending rows of type
+    template<class T>
+    struct Batch
+    {
+        // add/swap lock and commit lock, the latter keeps batches of type in order
+        std::mutex      sync;
+        std::mutex      flushSync;
+        std::vector<T>  rows;
+        std::vector<int> sids;          // server of each row, goes to change log
+        std::chrono::steady_clock::time_point first;
+        Limits          limits;
+        size_t          (Database::*func)(const T*,const int*,size_t,bool*);
+        // rows reference users and configuration objects, those are flushed first
+        bool            depends;
+        // metrics
+        MetricHistogram *rowsMetric;
+        MetricHistogram *waitMetric;
+        MetricCounter   *reasonMetric[REASON_TYPES];
+        Batch() : func(nullptr),depends(false),rowsMetric(nullptr),waitMetric(nullptr) { memset(&limits,0,sizeof(limits)); memset(reasonMetric,0,sizeof(reasonMetric)); }
+    };
+
+private:
+    // target
+    Database       *mDatabase;
+    // batches
+    Batch<TransQuote>       mQuotes;
+    Batch<TransTrade>       mTrades;
+    Batch<TransUser>        mUsers;
+    Batch<TransSymbol>      mSymbols;
+    Batch<TransGroup>       mGroups;
+    Batch<TransSymbolGroup> mSymbolGroups;
+    Batch<TransMargin>      mMargins;
+
+public:
+    // ctor/dtor
+    FlushScheduler();
+    ~FlushScheduler();
+    // init with limits per type, nullptr - defaults
+    bool            init(Database *database,const Limits *limits=nullptr);
+    void            shutdown();
+    // add row of server, batch is flushed at once if its count or byte limit is hit
+    bool            add(const TransQuote *trans,int sid=0)       { return(add(mQuotes,trans,sid));       }
+    bool            add(const TransTrade *trans,int sid=0)       { return(add(mTrades,trans,sid));       }
+    bool            add(const TransUser *trans,int sid=0)        { return(add(mUsers,trans,sid));        }
+    bool            add(const TransSymbol *trans,int sid=0)      { return(add(mSymbols,trans,sid));      }
+    bool            add(const TransGroup *trans,int sid=0)       { return(add(mGroups,trans,sid));       }
+    bool            add(const TransSymbolGroup *trans,int sid=0) { return(add(mSymbolGroups,trans,sid)); }
+    bool            add(const TransMargin *trans,int sid=0)      { return(add(mMargins,trans,sid));      }
+    // flush batches with passed deadline, returns ms until next deadline
+    UINT            poll();
+    // flush everything
+    void            flush();
+    // default limits of type
+    static Limits   defaults(int type);
+
+private:
+    template<class T>
+    void            setup(Batch<T> &batch,size_t (Database::*func)(const T*,const int*,size_t,bool*),const Limits &limits,const char *type);
+    template<class T>
+    bool            add(Batch<T> &batch,const T *trans,int sid);
+    template<class T>
+    size_t          flush(Batch<T> &batch,int reason);
+    // flush users and configuration objects referenced by trades and margin levels
+    void            flushDepends();
+    template<class T>
+    void            check(Batch<T> &batch,std::chrono::steady_clock::time_point now,UINT &timeout);
+};
@@ -0,0 +1,316 @@
+//////////////////////////////////////////////////////////////////////////
+// LaneQueue.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "RingQueue.h"
+#include "Metrics.h"
+
+//////////////////////////////////////////////////////////////////////////
+// key shards with priority lanes inside, items with equal key always go
+// to the same shard, one consumer per shard schedules its lanes by weight;
+// account and quote items reference configuration objects, so every
+// configuration item goes to shard 0 and items pushed after it wait until
+// shard 0 consumer is done with it, i.e. asks for its next item
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+class LaneQueue
+{
+public:
+    // transaction classes
+    enum EnLane
+    {
+        LANE_ACCOUNT=0,             // trades, users, margin levels
+        LANE_QUOTE  =1,             // quotes
+        LANE_CONFIG =2,             // symbols, groups, symbol groups
+        LANE_COUNT  =3
+    };
+
+private:
+    // queued item with enqueue time
+    struct Entry
+    {
+        T               item;
+        std::chrono::steady_clock::time_point time;
+        UINT64          barrier;        // configuration items to be done before this one
+    };
+    // shard, key keeps its lane so key order is lane order
+    struct Shard
+    {
+        RingQueue<Entry> lanes[LANE_COUNT];
+        UINT             cursor;        // schedule position, owned by consumer
+        // lane heads taken out of rings and waiting for their barrier, owned by consumer
+        Entry            heads[LANE_COUNT];
+        bool             held[LANE_COUNT];
+        bool             configOut;     // configuration item is being processed by consumer
+        // blocking wait of consumer on empty shard and producers on full lane
+        std::mutex       sync;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::atomic<int> consumers;
+        std::atomic<int> producers;
+        Shard() : cursor(0),configOut(false),consumers(0),producers(0) { memset(held,0,sizeof(held)); }
+    };
+    // constants
+    enum constants
+    {
+        WAIT_SLICE=10                   // ms, bounds wait on missed notification
+    };
+
+private:
+    std::vector<std::unique_ptr<Shard>> mShards;
+    // weighted schedule, slot is lane index repeated by weight
+    std::vector<UINT> mSchedule;
+    std::atomic<bool> mShutdown;
+    // configuration items pushed and done, pushes are serialized to keep count in ring order
+    std::mutex        mConfigSync;
+    std::atomic<UINT64> mConfigPushed;
+    std::atomic<UINT64> mConfigDone;
+    // metrics by lane
+    MetricHistogram *mLatency[LANE_COUNT];
+    MetricGauge     *mDepth[LANE_COUNT];
+
+public:
+    // ctor/dtor
+    LaneQueue() : mShutdown(false),mConfigPushed(0),mConfigDone(0)
+    {
+        memset(mLatency,0,sizeof(mLatency));
+        memset(mDepth,  0,sizeof(mDepth));
+    }
+    ~LaneQueue() {}
+    // init shards and lane capacity of each one, name labels metrics
+    bool init(const std::string &name,size_t shards,size_t capacity,const UINT weights[LANE_COUNT])
+    {
+        static const char *lanes[LANE_COUNT]={ "account","quote","config" };
+        // checks
+        if(shards==0 || !mShards.empty())
+            return(false);
+        // create shards
+        for(size_t i=0;i<shards;i++)
+        {
+            mShards.push_back(std::unique_ptr<Shard>(new Shard()));
+            for(UINT j=0;j<LANE_COUNT;j++)
+                if(!mShards.back()->lanes[j].init(capacity,RingQueue<Entry>::WAIT_SPIN))
+                    return(false);
+        }
+        // metrics
+        for(UINT i=0;i<LANE_COUNT;i++)
+        {
+            std::string labels="queue=\""+name+"\",lane=\""+lanes[i]+"\"";
+            mLatency[i]=Metrics::get().histogram("replication_lane_latency_us",labels,"Time spent in priority lane in microseconds");
+            mDepth[i]  =Metrics::get().gauge("replication_lane_depth",labels,"Transactions waiting in priority lane");
+        }
+        // interleave lanes by weight, e.g. 4:1:1 gives A Q C A A A
+        UINT left[LANE_COUNT];
+        for(UINT i=0;i<LANE_COUNT;i++)
+            left[i]=weights[i] ? weights[i] : 1;
+        mSchedule.clear();
+        for(bool added=true;added;)
+        {
+            added=false;
+            for(UINT i=0;i<LANE_COUNT;i++)
+                if(left[i])
+                {
+                    mSchedule.push_back(i);
+                    left[i]--;
+                    added=true;
+                }
+        }
+        mShutdown.store(false);
+        mConfigPushed.store(0);
+        mConfigDone.store(0);
+        // success
+        return(true);
+    }
+    // release waiting producers and consumers
+    void shutdown()
+    {
+        mShutdown.store(true);
+        for(auto &it : mShards)
+        {
+            std::lock_guard<std::mutex> lock(it->sync);
+            it->notEmpty.notify_all();
+            it->notFull.notify_all();
+        }
+    }
+    // shard of key
+    size_t shard(size_t key) const { return(key%mShards.size()); }
+    size_t shards() const          { return(mShards.size()); }
+    // enqueue by key to lane, sleeps while lane is full
+    bool push(size_t key,UINT lane,const T &item)
+    {
+        // checks
+        if(lane>=LANE_COUNT || mShards.empty())
+            return(false);
+        // configuration items are ordered by shard 0, the rest waits for ones pushed before
+        if(lane==LANE_CONFIG)
+        {
+            std::lock_guard<std::mutex> lock(mConfigSync);
+            if(!push(mShards[0].get(),lane,item,0))
+                return(false);
+            mConfigPushed.fetch_add(1);
+            return(true);
+        }
+        return(push(mShards[shard(key)].get(),lane,item,mConfigPushed.load()));
+    }
+    // dequeue from shard by weighted schedule, one consumer per shard keeps key order
+    bool pop(size_t shard,T &item,UINT timeout=INFINITE)
+    {
+        std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::time_point::max();
+        // checks
+        if(shard>=mShards.size())
+            return(false);
+        Shard *sh=mShards[shard].get();
+        // calculate deadline
+        if(timeout!=INFINITE)
+            deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(timeout);
+        // wait for data
+        while(!tryPop(shard,item))
+        {
+            if(mShutdown.load() || std::chrono::steady_clock::now()>=deadline)
+                return(false);
+            // register before retry, producers and configuration consumer check consumers after every change
+            std::unique_lock<std::mutex> lock(sh->sync);
+            sh->consumers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(ready(sh))
+            {
+                sh->consumers.fetch_sub(1);
+                continue;
+            }
+            std::chrono::steady_clock::time_point limit=std::chrono::steady_clock::now()+std::chrono::milliseconds(WAIT_SLICE);
+            sh->notEmpty.wait_until(lock,deadline<limit ? deadline : limit);
+            sh->consumers.fetch_sub(1);
+        }
+        // success
+        return(true);
+    }
+    // dequeue from shard without waiting, idle or waiting lane gives its turn to others
+    bool tryPop(size_t shard,T &item)
+    {
+        // checks
+        if(shard>=mShards.size() || mSchedule.empty())
+            return(false);
+        Shard *sh=mShards[shard].get();
+        // configuration item handed out before is done once its consumer is back
+        if(sh->configOut)
+        {
+            sh->configOut=false;
+            configDone();
+        }
+        UINT64 done=mConfigDone.load();
+        // scheduled lane first, then by priority
+        UINT first=mSchedule[sh->cursor++%mSchedule.size()];
+        for(UINT i=0;i<=LANE_COUNT;i++)
+        {
+            UINT lane=(i==0) ? first : i-1;
+            if(i>0 && lane==first)
+                continue;
+            // take lane head out of ring
+            if(!sh->held[lane])
+            {
+                if(!sh->lanes[lane].tryPop(sh->heads[lane]))
+                    continue;
+                sh->held[lane]=true;
+                // wake producers waiting for space
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(sh->producers.load()>0)
+                {
+                    std::lock_guard<std::mutex> lock(sh->sync);
+                    sh->notFull.notify_all();
+                }
+            }
+            // configuration pushed before head is still pending
+            if(sh->heads[lane].barrier>done)
+                continue;
+            sh->held[lane]=false;
+            if(lane==LANE_CONFIG)
+                sh->configOut=true;
+            // metrics
+            if(mDepth[lane])
+                mDepth[lane]->add(-1);
+            if(mLatency[lane])
+                mLatency[lane]->add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-sh->heads[lane].time).count());
+            item=sh->heads[lane].item;
+            return(true);
+        }
+        // all lanes are empty or waiting
+        return(false);
+    }
+    // depth of lane over all shards
+    size_t size(UINT lane) const
+    {
+        size_t res=0;
+        if(lane<LANE_COUNT)
+            for(auto &it : mShards)
+                res+=it->lanes[lane].size();
+        return(res);
+    }
+    size_t size() const
+    {
+        size_t res=0;
+        for(UINT i=0;i<LANE_COUNT;i++)
+            res+=size(i);
+        return(res);
+    }
+
+private:
+    // enqueue to shard lane, sleeps while lane is full
+    bool push(Shard *sh,UINT lane,const T &item,UINT64 barrier)
+    {
+        Entry entry;
+        // enqueue
+        entry.item   =item;
+        entry.time   =std::chrono::steady_clock::now();
+        entry.barrier=barrier;
+        while(!sh->lanes[lane].tryPush(entry))
+        {
+            if(mShutdown.load())
+                return(false);
+            // register before retry, consumer checks producers after every pop
+            std::unique_lock<std::mutex> lock(sh->sync);
+            sh->producers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(!sh->lanes[lane].tryPush(entry))
+            {
+                sh->notFull.wait_for(lock,std::chrono::milliseconds(WAIT_SLICE));
+                sh->producers.fetch_sub(1);
+                continue;
+            }
+            sh->producers.fetch_sub(1);
+            break;
+        }
+        if(mDepth[lane])
+            mDepth[lane]->add(1);
+        // wake consumer
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(sh->consumers.load()>0)
+        {
+            std::lock_guard<std::mutex> lock(sh->sync);
+            sh->notEmpty.notify_one();
+        }
+        // success
+        return(true);
+    }
+    // configuration item done, wake consumers holding items behind it
+    void configDone()
+    {
+        mConfigDone.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for(auto &it : mShards)
+            if(it->consumers.load()>0)
+            {
+                std::lock_guard<std::mutex> lock(it->sync);
+                it->notEmpty.notify_one();
+            }
+    }
+    // consumer has an item it may take
+    bool ready(Shard *sh) const
+    {
+        UINT64 done=mConfigDone.load();
+        for(UINT i=0;i<LANE_COUNT;i++)
+            if(sh->held[i] ? sh->heads[i].barrier<=done : sh->lanes[i].size()>0)
+                return(true);
+        return(false);
+    }
+};
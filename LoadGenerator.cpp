@@ -0,0 +1,224 @@
+//////////////////////////////////////////////////////////////////////////
+// LoadGenerator.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "LoadGenerator.h"
+#include "TransAllocator.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+LoadGenerator::LoadGenerator()
+    : mThread(nullptr),
+      mStop(false),
+      mTicket(0),
+      mRandom(1)
+{
+    memset(&mProfile,0,sizeof(mProfile));
+    for(UINT i=0;i<LOAD_TYPES;i++)
+        mSent[i].store(0);
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+LoadGenerator::~LoadGenerator()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// start generation
+//////////////////////////////////////////////////////////////////////////
+bool LoadGenerator::init(const Profile &profile,ReceiveFunc func)
+{
+    // checks
+    if(mThread || !func || profile.symbols==0 || profile.accounts==0)
+        return(false);
+    // copy params
+    mProfile=profile;
+    mFunc   =func;
+    mTicket =0;
+    // timestamps tables
+    mQuoteSent.reset(new std::atomic<INT64>[mProfile.symbols]);
+    mTradeSent.reset(new std::atomic<INT64>[TICKETS_WINDOW]);
+    mUserSent.reset(new std::atomic<INT64>[mProfile.accounts]);
+    mMarginSent.reset(new std::atomic<INT64>[mProfile.accounts]);
+    for(UINT i=0;i<mProfile.symbols;i++)  mQuoteSent[i].store(0);
+    for(UINT i=0;i<TICKETS_WINDOW;i++)    mTradeSent[i].store(0);
+    for(UINT i=0;i<mProfile.accounts;i++) { mUserSent[i].store(0); mMarginSent[i].store(0); }
+    for(UINT i=0;i<LOAD_TYPES;i++)
+        mSent[i].store(0);
+    // start thread
+    mStop.store(false);
+    mStart =std::chrono::steady_clock::now();
+    mFinish=mStart;
+    mThread=new std::thread(&LoadGenerator::funcWrapGenerate,this);
+    // log info
+    Logger::get().log("load generator: %u ticks/s on %u symbols, %u trades/s, %u users/s, %u margins/s on %u accounts",
+                      mProfile.ticks,mProfile.symbols,mProfile.trades,mProfile.users,mProfile.margins,mProfile.accounts);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// stop generation
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::shutdown()
+{
+    // checks
+    if(mThread==nullptr)
+        return;
+    // stop thread
+    mStop.store(true);
+    mThread->join();
+    delete(mThread);
+    mThread=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// send timestamps
+//////////////////////////////////////////////////////////////////////////
+INT64 LoadGenerator::sent(const TransQuote *trans) const
+{
+    int index=symbolIndex(trans->data.symbol);
+    return((mQuoteSent && index>=0 && (UINT)index<mProfile.symbols) ? mQuoteSent[index].load() : 0);
+}
+INT64 LoadGenerator::sent(const TransTrade *trans) const
+{
+    return((mTradeSent && trans->data.order>0) ? mTradeSent[trans->data.order%TICKETS_WINDOW].load() : 0);
+}
+INT64 LoadGenerator::sent(const TransUser *trans) const
+{
+    return((mUserSent && trans->data.login>0 && (UINT)trans->data.login<=mProfile.accounts) ? mUserSent[trans->data.login-1].load() : 0);
+}
+INT64 LoadGenerator::sent(const TransMargin *trans) const
+{
+    return((mMarginSent && trans->data.login>0 && (UINT)trans->data.login<=mProfile.accounts) ? mMarginSent[trans->data.login-1].load() : 0);
+}
+//////////////////////////////////////////////////////////////////////////
+// current time in microseconds
+//////////////////////////////////////////////////////////////////////////
+INT64 LoadGenerator::now()
+{
+    return(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+//////////////////////////////////////////////////////////////////////////
+// log generated load
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::report()
+{
+    std::chrono::steady_clock::time_point end=running() ? std::chrono::steady_clock::now() : mFinish;
+    double seconds=std::chrono::duration<double>(end-mStart).count();
+    // checks
+    if(seconds<=0)
+        return;
+    Logger::get().log("load generator: %.1f s, sent %I64u quotes (%.0f/s), %I64u trades (%.0f/s), %I64u users (%.0f/s), %I64u margins (%.0f/s)",seconds,
+                      mSent[LOAD_QUOTE].load(), mSent[LOAD_QUOTE].load()/seconds,
+                      mSent[LOAD_TRADE].load(), mSent[LOAD_TRADE].load()/seconds,
+                      mSent[LOAD_USER].load(),  mSent[LOAD_USER].load()/seconds,
+                      mSent[LOAD_MARGIN].load(),mSent[LOAD_MARGIN].load()/seconds);
+}
+//////////////////////////////////////////////////////////////////////////
+// generator thread
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::funcWrapGenerate(void *param)
+{
+    if(param)
+        static_cast<LoadGenerator*>(param)->runGenerate();
+}
+void LoadGenerator::runGenerate()
+{
+    UINT64 due[LOAD_TYPES];
+    UINT   rates[LOAD_TYPES]={ mProfile.ticks,mProfile.trades,mProfile.users,mProfile.margins };
+    // generate until stopped or duration passed
+    while(!mStop.load())
+    {
+        std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+        double elapsed=std::chrono::duration<double>(now-mStart).count();
+        // duration reached
+        if(mProfile.duration && elapsed>=mProfile.duration)
+            break;
+        // catch up with rates
+        for(UINT i=0;i<LOAD_TYPES;i++)
+            due[i]=(UINT64)(rates[i]*elapsed);
+        while(mSent[LOAD_QUOTE].load() <due[LOAD_QUOTE])  genQuote();
+        while(mSent[LOAD_TRADE].load() <due[LOAD_TRADE])  genTrade();
+        while(mSent[LOAD_USER].load()  <due[LOAD_USER])   genUser();
+        while(mSent[LOAD_MARGIN].load()<due[LOAD_MARGIN]) genMargin();
+        // next step
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mFinish=std::chrono::steady_clock::now();
+    mStop.store(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// quote of random symbol
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::genQuote()
+{
+    TransQuote *trans=TransAllocator::get().alloc<TransQuote>();
+    UINT        index=random(mProfile.symbols);
+    // fill
+    _snprintf_s(trans->data.symbol,_countof(trans->data.symbol),_TRUNCATE,"SYM%05u",index);
+    // stamp and send
+    mQuoteSent[index].store(now());
+    mSent[LOAD_QUOTE]++;
+    mFunc(trans);
+}
+//////////////////////////////////////////////////////////////////////////
+// new trade of random account
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::genTrade()
+{
+    TransTrade *trans=TransAllocator::get().alloc<TransTrade>();
+    // fill
+    trans->data.order=++mTicket;
+    trans->data.login=random(mProfile.accounts)+1;
+    // stamp and send
+    mTradeSent[trans->data.order%TICKETS_WINDOW].store(now());
+    mSent[LOAD_TRADE]++;
+    mFunc(trans);
+}
+//////////////////////////////////////////////////////////////////////////
+// user update
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::genUser()
+{
+    TransUser *trans=TransAllocator::get().alloc<TransUser>();
+    // fill
+    trans->data.login=random(mProfile.accounts)+1;
+    // stamp and send
+    mUserSent[trans->data.login-1].store(now());
+    mSent[LOAD_USER]++;
+    mFunc(trans);
+}
+//////////////////////////////////////////////////////////////////////////
+// margin level update
+//////////////////////////////////////////////////////////////////////////
+void LoadGenerator::genMargin()
+{
+    TransMargin *trans=TransAllocator::get().alloc<TransMargin>();
+    // fill
+    trans->data.login=random(mProfile.accounts)+1;
+    // stamp and send
+    mMarginSent[trans->data.login-1].store(now());
+    mSent[LOAD_MARGIN]++;
+    mFunc(trans);
+}
+//////////////////////////////////////////////////////////////////////////
+// xorshift random in [0,range)
+//////////////////////////////////////////////////////////////////////////
+UINT LoadGenerator::random(UINT range)
+{
+    mRandom^=mRandom<<13;
+    mRandom^=mRandom>>17;
+    mRandom^=mRandom<<5;
+    return(range ? mRandom%range : 0);
+}
+//////////////////////////////////////////////////////////////////////////
+// index from generated symbol name
+//////////////////////////////////////////////////////////////////////////
+int LoadGenerator::symbolIndex(const char *symbol)
+{
+    if(symbol==nullptr || strncmp(symbol,"SYM",3)!=0)
+        return(-1);
+    return(atoi(symbol+3));
+}
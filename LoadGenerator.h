@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+// LoadGenerator.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+
+//////////////////////////////////////////////////////////////////////////
+// synthetic MT4 feed for load testing without live servers
+//////////////////////////////////////////////////////////////////////////
+class LoadGenerator
+{
+public:
+    // load profile, rates are per second
+    struct Profile
+    {
+        UINT            ticks;          // quotes
+        UINT            symbols;        // symbols count
+        UINT            trades;         // trade updates
+        UINT            users;          // user updates
+        UINT            margins;        // margin level updates
+        UINT            accounts;       // accounts count
+        UINT            duration;       // seconds, 0 - until shutdown
+    };
+    // receiver of generated transactions, normally Replication::onReceive
+    typedef std::function<void(TransGeneric*)> ReceiveFunc;
+
+private:
+    // generated transaction types
+    enum EnLoadType
+    {
+        LOAD_QUOTE =0,
+        LOAD_TRADE =1,
+        LOAD_USER  =2,
+        LOAD_MARGIN=3,
+        LOAD_TYPES =4
+    };
+    // trade tickets tracked for latency
+    enum { TICKETS_WINDOW=1<<20 };
+
+private:
+    // settings
+    Profile         mProfile;
+    ReceiveFunc     mFunc;
+    // generator thread
+    std::thread    *mThread;
+    std::atomic<bool> mStop;
+    std::chrono::steady_clock::time_point mStart;
+    std::chrono::steady_clock::time_point mFinish;
+    // send timestamps for end-to-end latency
+    std::unique_ptr<std::atomic<INT64>[]> mQuoteSent;
+    std::unique_ptr<std::atomic<INT64>[]> mTradeSent;
+    std::unique_ptr<std::atomic<INT64>[]> mUserSent;
+    std::unique_ptr<std::atomic<INT64>[]> mMarginSent;
+    // counters
+    std::atomic<UINT64> mSent[LOAD_TYPES];
+    int             mTicket;
+    UINT            mRandom;
+
+public:
+    // ctor/dtor
+    LoadGenerator();
+    ~LoadGenerator();
+    // start/stop generation
+    bool            init(const Profile &profile,ReceiveFunc func);
+    void            shutdown();
+    bool            running() const { return(mThread!=nullptr && !mStop.load()); }
+    // send time of transaction in microseconds, 0 if unknown
+    INT64           sent(const TransQuote *trans) const;
+    INT64           sent(const TransTrade *trans) const;
+    INT64           sent(const TransUser *trans) const;
+    INT64           sent(const TransMargin *trans) const;
+    // current time in microseconds
+    static INT64    now();
+    // log generated load
+    void            report();
+
+private:
+    // generator thread
+    static void     funcWrapGenerate(void *param);
+    void            runGenerate();
+    // generate transactions
+    void            genQuote();
+    void            genTrade();
+    void            genUser();
+    void            genMargin();
+    UINT            random(UINT range);
+    static int      symbolIndex(const char *symbol);
+};
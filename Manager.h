@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Workpool.h"
+#include "Checkpoint.h"
 //////////////////////////////////////////////////////////////////////////
 // forward declarations
 //////////////////////////////////////////////////////////////////////////
@@ -31,6 +32,8 @@ private:
     std::mutex      mSync;
     // last ping timestamp
     __int64         mPingTime;
+    // replication checkpoint for incremental resync
+    Checkpoint      mCheckpoint;
     // transactions queue
     Workpool<TransGeneric*> &mQueue;
 
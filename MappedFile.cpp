@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////
+// MappedFile.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "MappedFile.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile()
+    : mFile(INVALID_HANDLE_VALUE),
+      mMapping(nullptr),
+      mData(nullptr),
+      mSize(0)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+    close();
+}
+//////////////////////////////////////////////////////////////////////////
+// open or create file
+//////////////////////////////////////////////////////////////////////////
+bool MappedFile::open(const std::string &path,UINT64 size,bool readonly)
+{
+    LARGE_INTEGER current;
+    // checks
+    if(path.empty() || (size==0 && !readonly))
+        return(false);
+    // close previous
+    close();
+    // open file
+    mFile=CreateFileA(path.c_str(),readonly ? GENERIC_READ : GENERIC_READ|GENERIC_WRITE,
+                      FILE_SHARE_READ|FILE_SHARE_WRITE,nullptr,readonly ? OPEN_EXISTING : OPEN_ALWAYS,FILE_ATTRIBUTE_NORMAL,nullptr);
+    if(mFile==INVALID_HANDLE_VALUE)
+    {
+        Logger::get().log("failed to open '%s' file [%u]",path.c_str(),GetLastError());
+        return(false);
+    }
+    mPath=path;
+    // keep existing size if it is bigger
+    if(!GetFileSizeEx(mFile,&current))
+    {
+        close();
+        return(false);
+    }
+    mSize=((UINT64)current.QuadPart>size) ? (UINT64)current.QuadPart : size;
+    // empty read-only file cannot be mapped
+    if(mSize==0)
+    {
+        close();
+        return(false);
+    }
+    // map file
+    if(!map(mSize,readonly,mMapping,mData))
+    {
+        close();
+        return(false);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// close file
+//////////////////////////////////////////////////////////////////////////
+void MappedFile::close()
+{
+    // unmap view
+    unmap();
+    // close file
+    if(mFile!=INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+        mFile=INVALID_HANDLE_VALUE;
+    }
+    mSize=0;
+}
+//////////////////////////////////////////////////////////////////////////
+// grow file
+//////////////////////////////////////////////////////////////////////////
+bool MappedFile::resize(UINT64 size)
+{
+    // checks
+    if(mFile==INVALID_HANDLE_VALUE || size<=mSize)
+        return(size<=mSize);
+    HANDLE mapping=nullptr;
+    char  *data=nullptr;
+    // map new size first, old view stays valid on failure
+    if(!map(size,false,mapping,data))
+    {
+        Logger::get().log("failed to grow '%s' file to %I64u bytes [%u]",mPath.c_str(),size,GetLastError());
+        return(false);
+    }
+    // swap views
+    unmap();
+    mMapping=mapping;
+    mData   =data;
+    mSize   =size;
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// flush range to disk
+//////////////////////////////////////////////////////////////////////////
+bool MappedFile::flush(UINT64 offset,UINT64 length)
+{
+    // checks
+    if(mData==nullptr || offset+length>mSize)
+        return(false);
+    // write dirty pages and file metadata
+    if(!FlushViewOfFile(mData+offset,(SIZE_T)length))
+        return(false);
+    return(FlushFileBuffers(mFile)!=FALSE);
+}
+//////////////////////////////////////////////////////////////////////////
+// map view, file is extended to mapping size
+//////////////////////////////////////////////////////////////////////////
+bool MappedFile::map(UINT64 size,bool readonly,HANDLE &mapping,char *&data)
+{
+    // create mapping
+    mapping=CreateFileMappingA(mFile,nullptr,readonly ? PAGE_READONLY : PAGE_READWRITE,(DWORD)(size>>32),(DWORD)(size&0xFFFFFFFF),nullptr);
+    if(mapping==nullptr)
+        return(false);
+    // map view
+    data=static_cast<char*>(MapViewOfFile(mapping,readonly ? FILE_MAP_READ : FILE_MAP_WRITE,0,0,(SIZE_T)size));
+    if(data==nullptr)
+    {
+        CloseHandle(mapping);
+        mapping=nullptr;
+        return(false);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// unmap view
+//////////////////////////////////////////////////////////////////////////
+void MappedFile::unmap()
+{
+    if(mData)
+    {
+        UnmapViewOfFile(mData);
+        mData=nullptr;
+    }
+    if(mMapping)
+    {
+        CloseHandle(mMapping);
+        mMapping=nullptr;
+    }
+}
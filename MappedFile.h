@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////////////
+// MappedFile.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// growable memory-mapped file
+//////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+private:
+    // file handles
+    HANDLE          mFile;
+    HANDLE          mMapping;
+    // mapped view
+    char           *mData;
+    UINT64          mSize;
+    // file name
+    std::string     mPath;
+
+public:
+    // ctor/dtor
+    MappedFile();
+    ~MappedFile();
+    // open or create file, mapping at least size bytes
+    bool            open(const std::string &path,UINT64 size,bool readonly=false);
+    void            close();
+    // grow file and remap, pointers to old view become invalid
+    bool            resize(UINT64 size);
+    // flush range to disk
+    bool            flush(UINT64 offset,UINT64 length);
+    // access
+    char           *data()         { return(mData); }
+    UINT64          size() const   { return(mSize); }
+    bool            opened() const { return(mData!=nullptr); }
+    const std::string &path() const { return(mPath); }
+
+private:
+    // map/unmap view
+    bool            map(UINT64 size,bool readonly,HANDLE &mapping,char *&data);
+    void            unmap();
+};
@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////
+// MarginCache.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "MarginCache.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+MarginCache::MarginCache()
+    : mChecked(0),
+      mSkipped(0)
+{
+    memset(&mTolerance,0,sizeof(mTolerance));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+MarginCache::~MarginCache()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// init tolerances
+//////////////////////////////////////////////////////////////////////////
+void MarginCache::init(const Tolerance &tolerance)
+{
+    // lock
+    mSync.lock();
+    mTolerance=tolerance;
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// check and remember margin level
+//////////////////////////////////////////////////////////////////////////
+bool MarginCache::update(int sid,const TransMargin *trans)
+{
+    // checks
+    if(trans==nullptr)
+        return(false);
+    // lock
+    mSync.lock();
+    mChecked++;
+    // find last written
+    UINT64 id=key(sid,trans->data.login);
+    MarginCacheMap::iterator it=mMargins.find(id);
+    if(it!=mMargins.end() && !changed(it->second,*trans))
+    {
+        mSkipped++;
+        mSync.unlock();
+        return(false);
+    }
+    // remember as written
+    if(it==mMargins.end())
+        mMargins.insert(std::make_pair(id,*trans));
+    else
+        it->second=*trans;
+    // unlock
+    mSync.unlock();
+    // must be written
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// forget account
+//////////////////////////////////////////////////////////////////////////
+void MarginCache::invalidate(int sid,int login)
+{
+    // lock
+    mSync.lock();
+    mMargins.erase(key(sid,login));
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// forget everything
+//////////////////////////////////////////////////////////////////////////
+void MarginCache::clear()
+{
+    // lock
+    mSync.lock();
+    mMargins.clear();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// counters
+//////////////////////////////////////////////////////////////////////////
+MarginCache::Stats MarginCache::stats()
+{
+    Stats res;
+    // lock
+    mSync.lock();
+    res.checked =mChecked;
+    res.skipped =mSkipped;
+    res.accounts=mMargins.size();
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// compare with tolerances
+//////////////////////////////////////////////////////////////////////////
+bool MarginCache::changed(const TransMargin &last,const TransMargin &trans) const
+{
+    // discrete fields must match exactly
+    if(last.data.leverage!=trans.data.leverage || last.data.volume!=trans.data.volume ||
+       last.data.level_type!=trans.data.level_type || strcmp(last.data.group,trans.data.group)!=0)
+        return(true);
+    // money fields within tolerance
+    if(fabs(last.data.balance     -trans.data.balance)     >mTolerance.balance     ||
+       fabs(last.data.equity      -trans.data.equity)      >mTolerance.equity      ||
+       fabs(last.data.margin      -trans.data.margin)      >mTolerance.margin      ||
+       fabs(last.data.margin_free -trans.data.margin_free) >mTolerance.margin_free ||
+       fabs(last.data.margin_level-trans.data.margin_level)>mTolerance.margin_level)
+        return(true);
+    // unchanged
+    return(false);
+}
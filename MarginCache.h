@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////
+// MarginCache.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+
+//////////////////////////////////////////////////////////////////////////
+// type definitions
+//////////////////////////////////////////////////////////////////////////
+typedef std::unordered_map<UINT64,TransMargin> MarginCacheMap;
+
+//////////////////////////////////////////////////////////////////////////
+// last written margin levels, suppresses unchanged updates
+//////////////////////////////////////////////////////////////////////////
+class MarginCache
+{
+public:
+    // absolute tolerances per field, changes within tolerance are not written
+    struct Tolerance
+    {
+        double      balance;
+        double      equity;
+        double      margin;
+        double      margin_free;
+        double      margin_level;
+    };
+    // counters
+    struct Stats
+    {
+        UINT64      checked;        // margin levels checked
+        UINT64      skipped;        // unchanged margin levels
+        UINT64      accounts;       // accounts in cache
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // last written margin level by server and login
+    MarginCacheMap  mMargins;
+    Tolerance       mTolerance;
+    // counters
+    UINT64          mChecked;
+    UINT64          mSkipped;
+
+public:
+    // ctor/dtor
+    MarginCache();
+    ~MarginCache();
+    // init tolerances
+    void            init(const Tolerance &tolerance);
+    // returns true if margin level must be written, remembers it as written
+    bool            update(int sid,const TransMargin *trans);
+    // forget account after failed commit, next update is written
+    void            invalidate(int sid,int login);
+    // forget everything, e.g. after server resync
+    void            clear();
+    // counters
+    Stats           stats();
+
+private:
+    static UINT64   key(int sid,int login) { return(((UINT64)(UINT)sid<<32)|(UINT)login); }
+    bool            changed(const TransMargin &last,const TransMargin &trans) const;
+};
@@ -0,0 +1,347 @@
+//////////////////////////////////////////////////////////////////////////
+// Metrics.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Metrics.h"
+#include "ThreadPlacement.h"
+#include <winsock2.h>
+#include <afunix.h>
+#include <fstream>
+
+//////////////////////////////////////////////////////////////////////////
+// histogram ctor
+//////////////////////////////////////////////////////////////////////////
+MetricHistogram::MetricHistogram()
+    : mCount(0),
+      mSum(0),
+      mMax(0)
+{
+    for(UINT i=0;i<BUCKETS;i++)
+        mBuckets[i].store(0,std::memory_order_relaxed);
+}
+//////////////////////////////////////////////////////////////////////////
+// record value
+//////////////////////////////////////////////////////////////////////////
+void MetricHistogram::add(UINT64 value)
+{
+    mBuckets[bucket(value)].fetch_add(1,std::memory_order_relaxed);
+    mCount.fetch_add(1,std::memory_order_relaxed);
+    mSum.fetch_add(value,std::memory_order_relaxed);
+    // update max
+    UINT64 max=mMax.load(std::memory_order_relaxed);
+    while(value>max && !mMax.compare_exchange_weak(max,value,std::memory_order_relaxed))
+        ;
+}
+//////////////////////////////////////////////////////////////////////////
+// value at percentile
+//////////////////////////////////////////////////////////////////////////
+UINT64 MetricHistogram::percentile(double pct) const
+{
+    UINT64 total=count(),rank,seen=0;
+    // checks
+    if(total==0)
+        return(0);
+    // rank of value
+    rank=(UINT64)(total*pct/100.0);
+    if(rank==0)
+        rank=1;
+    // find bucket
+    for(UINT i=0;i<BUCKETS;i++)
+    {
+        seen+=mBuckets[i].load(std::memory_order_relaxed);
+        if(seen>=rank)
+            return(upper(i)<max() ? upper(i) : max());
+    }
+    return(max());
+}
+//////////////////////////////////////////////////////////////////////////
+// number of values less or equal to bound
+//////////////////////////////////////////////////////////////////////////
+UINT64 MetricHistogram::countBelow(UINT64 bound) const
+{
+    UINT64 res=0;
+    for(UINT i=0;i<BUCKETS && upper(i)<=bound;i++)
+        res+=mBuckets[i].load(std::memory_order_relaxed);
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// bucket index of value
+//////////////////////////////////////////////////////////////////////////
+UINT MetricHistogram::bucket(UINT64 value)
+{
+    unsigned long msb;
+    // linear range
+    if(value<SUB_COUNT)
+        return((UINT)value);
+    // octave and sub-bucket
+    _BitScanReverse64(&msb,value);
+    UINT octave=msb-SUB_BITS+1;
+    UINT sub   =(UINT)(value>>(msb-SUB_BITS))&(SUB_COUNT-1);
+    // clamp to last bucket
+    if(octave>=OCTAVES)
+        return(BUCKETS-1);
+    return(octave*SUB_COUNT+sub);
+}
+//////////////////////////////////////////////////////////////////////////
+// upper bound of bucket
+//////////////////////////////////////////////////////////////////////////
+UINT64 MetricHistogram::upper(UINT index)
+{
+    // linear range
+    if(index<SUB_COUNT)
+        return(index);
+    // last bucket is open
+    if(index>=BUCKETS-1)
+        return(_UI64_MAX);
+    UINT octave=index/SUB_COUNT;
+    UINT sub   =index%SUB_COUNT;
+    UINT shift =octave-1;
+    return((((UINT64)(SUB_COUNT+sub))<<shift)+(((UINT64)1)<<shift)-1);
+}
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+Metrics::Metrics()
+    : mInterval(0),
+      mThread(nullptr),
+      mStop(false)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+Metrics::~Metrics()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// singleton
+//////////////////////////////////////////////////////////////////////////
+Metrics &Metrics::get()
+{
+    static Metrics metrics;
+    return(metrics);
+}
+//////////////////////////////////////////////////////////////////////////
+// find or create entry
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+T *Metrics::find(std::vector<Entry<T>> &list,const std::string &name,const std::string &labels,const std::string &help)
+{
+    T *res;
+    // lock
+    mSync.lock();
+    // search existing
+    for(auto &it : list)
+        if(it.name==name && it.labels==labels)
+        {
+            res=it.metric.get();
+            mSync.unlock();
+            return(res);
+        }
+    // create new
+    Entry<T> entry;
+    entry.name  =name;
+    entry.labels=labels;
+    entry.help  =help;
+    entry.metric.reset(new T());
+    res=entry.metric.get();
+    // keep series of the same name together for export
+    size_t pos=list.size();
+    for(size_t i=0;i<list.size();i++)
+        if(list[i].name==name)
+            pos=i+1;
+    list.insert(list.begin()+pos,std::move(entry));
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// register metrics
+//////////////////////////////////////////////////////////////////////////
+MetricCounter *Metrics::counter(const std::string &name,const std::string &labels,const std::string &help)
+{
+    return(find(mCounters,name,labels,help));
+}
+MetricGauge *Metrics::gauge(const std::string &name,const std::string &labels,const std::string &help)
+{
+    return(find(mGauges,name,labels,help));
+}
+MetricHistogram *Metrics::histogram(const std::string &name,const std::string &labels,const std::string &help)
+{
+    return(find(mHistograms,name,labels,help));
+}
+//////////////////////////////////////////////////////////////////////////
+// start exporter
+//////////////////////////////////////////////////////////////////////////
+bool Metrics::init(const std::string &file,const std::string &socket,UINT interval)
+{
+    // checks
+    if(mThread || (file.empty() && socket.empty()))
+        return(false);
+    // copy params
+    mFile    =file;
+    mSocket  =socket;
+    mInterval=interval ? interval : 1000;
+    // start thread
+    mStop.store(false);
+    mThread=new std::thread(&Metrics::funcWrapExport,this);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// stop exporter
+//////////////////////////////////////////////////////////////////////////
+void Metrics::shutdown()
+{
+    // checks
+    if(mThread==nullptr)
+        return;
+    // wake and wait exporter
+    mStop.store(true);
+    mStopSync.lock();
+    mStopCond.notify_all();
+    mStopSync.unlock();
+    mThread->join();
+    delete(mThread);
+    mThread=nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+// Prometheus text format
+//////////////////////////////////////////////////////////////////////////
+std::string Metrics::format()
+{
+    std::ostringstream out;
+    std::string        last;
+    // lock
+    mSync.lock();
+    // counters
+    for(auto &it : mCounters)
+    {
+        if(it.name!=last)
+            out << "# HELP " << it.name << " " << it.help << "\n# TYPE " << it.name << " counter\n";
+        out << it.name << "{" << it.labels << "} " << it.metric->value() << "\n";
+        last=it.name;
+    }
+    // gauges
+    for(auto &it : mGauges)
+    {
+        if(it.name!=last)
+            out << "# HELP " << it.name << " " << it.help << "\n# TYPE " << it.name << " gauge\n";
+        out << it.name << "{" << it.labels << "} " << it.metric->value() << "\n";
+        last=it.name;
+    }
+    // histograms, cumulative buckets on octave bounds
+    for(auto &it : mHistograms)
+    {
+        std::string sep=it.labels.empty() ? "" : ",";
+        if(it.name!=last)
+            out << "# HELP " << it.name << " " << it.help << "\n# TYPE " << it.name << " histogram\n";
+        for(UINT octave=1;octave<MetricHistogram::OCTAVES;octave++)
+        {
+            UINT64 bound=(((UINT64)1)<<(octave+MetricHistogram::SUB_BITS))-1;
+            out << it.name << "_bucket{" << it.labels << sep << "le=\"" << bound << "\"} " << it.metric->countBelow(bound) << "\n";
+        }
+        out << it.name << "_bucket{" << it.labels << sep << "le=\"+Inf\"} " << it.metric->count() << "\n";
+        out << it.name << "_sum{"   << it.labels << "} " << it.metric->sum()   << "\n";
+        out << it.name << "_count{" << it.labels << "} " << it.metric->count() << "\n";
+        last=it.name;
+    }
+    // unlock
+    mSync.unlock();
+    // result
+    return(out.str());
+}
+//////////////////////////////////////////////////////////////////////////
+// write file atomically
+//////////////////////////////////////////////////////////////////////////
+bool Metrics::writeFile(const std::string &text)
+{
+    std::string   tmp=mFile+".tmp";
+    std::ofstream f;
+    // write temporary file
+    f.open(tmp,std::ios::out|std::ios::trunc|std::ios::binary);
+    if(f.fail())
+        return(false);
+    f.write(text.c_str(),text.size());
+    f.close();
+    // replace
+    return(MoveFileExA(tmp.c_str(),mFile.c_str(),MOVEFILE_REPLACE_EXISTING)!=FALSE);
+}
+//////////////////////////////////////////////////////////////////////////
+// exporter thread
+//////////////////////////////////////////////////////////////////////////
+void Metrics::funcWrapExport(void *param)
+{
+    if(param)
+        static_cast<Metrics*>(param)->runExport();
+}
+void Metrics::runExport()
+{
+    SOCKET listener=INVALID_SOCKET;
+    std::chrono::steady_clock::time_point next=std::chrono::steady_clock::now();
+    WSADATA wsa;
+    bool    wsainit=false;
+    // name and pin exporter
+    ThreadPlacement::get().apply(ThreadPlacement::ROLE_SERVICE,2);
+    // open local socket
+    if(!mSocket.empty() && WSAStartup(MAKEWORD(2,2),&wsa)==0)
+    {
+        wsainit=true;
+        sockaddr_un addr={0};
+        addr.sun_family=AF_UNIX;
+        strncpy_s(addr.sun_path,mSocket.c_str(),_TRUNCATE);
+        DeleteFileA(mSocket.c_str());
+        listener=::socket(AF_UNIX,SOCK_STREAM,0);
+        if(listener==INVALID_SOCKET || bind(listener,(sockaddr*)&addr,sizeof(addr))==SOCKET_ERROR || listen(listener,4)==SOCKET_ERROR)
+        {
+            Logger::get().log("metrics: failed to listen on '%s' [%d]",mSocket.c_str(),WSAGetLastError());
+            if(listener!=INVALID_SOCKET)
+                closesocket(listener);
+            listener=INVALID_SOCKET;
+        }
+    }
+    // export loop
+    while(!mStop.load())
+    {
+        // periodic file export
+        if(!mFile.empty() && std::chrono::steady_clock::now()>=next)
+        {
+            writeFile(format());
+            next=std::chrono::steady_clock::now()+std::chrono::milliseconds(mInterval);
+        }
+        // no socket, just sleep
+        if(listener==INVALID_SOCKET)
+        {
+            std::unique_lock<std::mutex> lock(mStopSync);
+            mStopCond.wait_for(lock,std::chrono::milliseconds(mInterval),[this]() { return(mStop.load()); });
+            continue;
+        }
+        // serve scrape requests
+        fd_set  set;
+        timeval tv={0,100*1000};
+        FD_ZERO(&set);
+        FD_SET(listener,&set);
+        if(select(0,&set,nullptr,nullptr,&tv)<=0)
+            continue;
+        SOCKET client=accept(listener,nullptr,nullptr);
+        if(client==INVALID_SOCKET)
+            continue;
+        std::string text=format();
+        send(client,text.c_str(),(int)text.size(),0);
+        closesocket(client);
+    }
+    // close socket
+    if(listener!=INVALID_SOCKET)
+    {
+        closesocket(listener);
+        DeleteFileA(mSocket.c_str());
+    }
+    if(wsainit)
+        WSACleanup();
+    // last export
+    if(!mFile.empty())
+        writeFile(format());
+}
@@ -0,0 +1,142 @@
+//////////////////////////////////////////////////////////////////////////
+// Metrics.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// monotonic counter
+//////////////////////////////////////////////////////////////////////////
+class MetricCounter
+{
+private:
+    std::atomic<UINT64> mValue;
+
+public:
+    MetricCounter() : mValue(0) {}
+    void            add(UINT64 value=1) { mValue.fetch_add(value,std::memory_order_relaxed); }
+    UINT64          value() const       { return(mValue.load(std::memory_order_relaxed)); }
+};
+//////////////////////////////////////////////////////////////////////////
+// current value
+//////////////////////////////////////////////////////////////////////////
+class MetricGauge
+{
+private:
+    std::atomic<INT64> mValue;
+
+public:
+    MetricGauge() : mValue(0) {}
+    void            set(INT64 value)    { mValue.store(value,std::memory_order_relaxed); }
+    void            add(INT64 value)    { mValue.fetch_add(value,std::memory_order_relaxed); }
+    INT64           value() const       { return(mValue.load(std::memory_order_relaxed)); }
+};
+//////////////////////////////////////////////////////////////////////////
+// log-linear latency histogram in microseconds
+//////////////////////////////////////////////////////////////////////////
+class MetricHistogram
+{
+public:
+    // buckets layout, each power of two is split into sub-buckets
+    enum constants
+    {
+        SUB_BITS   =2,
+        SUB_COUNT  =1<<SUB_BITS,
+        OCTAVES    =27,             // up to ~2 minutes
+        BUCKETS    =OCTAVES*SUB_COUNT
+    };
+
+private:
+    std::atomic<UINT64> mBuckets[BUCKETS];
+    std::atomic<UINT64> mCount;
+    std::atomic<UINT64> mSum;
+    std::atomic<UINT64> mMax;
+
+public:
+    MetricHistogram();
+    // record value
+    void            add(UINT64 value);
+    // totals
+    UINT64          count() const       { return(mCount.load(std::memory_order_relaxed)); }
+    UINT64          sum() const         { return(mSum.load(std::memory_order_relaxed)); }
+    UINT64          max() const         { return(mMax.load(std::memory_order_relaxed)); }
+    // value at percentile (0..100), upper bound of bucket
+    UINT64          percentile(double pct) const;
+    // number of values less or equal to bound
+    UINT64          countBelow(UINT64 bound) const;
+
+private:
+    static UINT     bucket(UINT64 value);
+    static UINT64   upper(UINT index);
+};
+//////////////////////////////////////////////////////////////////////////
+// measures scope duration into histogram
+//////////////////////////////////////////////////////////////////////////
+class MetricTimer
+{
+private:
+    MetricHistogram *mHistogram;
+    std::chrono::steady_clock::time_point mStart;
+
+public:
+    explicit MetricTimer(MetricHistogram *histogram) : mHistogram(histogram),mStart(std::chrono::steady_clock::now()) {}
+    ~MetricTimer()
+    {
+        if(mHistogram)
+            mHistogram->add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-mStart).count());
+    }
+};
+//////////////////////////////////////////////////////////////////////////
+// metrics registry and exporter
+//////////////////////////////////////////////////////////////////////////
+class Metrics
+{
+private:
+    // registered metric
+    template<class T>
+    struct Entry
+    {
+        std::string     name;
+        std::string     labels;         // 'key="value",...' without braces
+        std::string     help;
+        std::unique_ptr<T> metric;
+    };
+    // registry
+    std::mutex      mSync;
+    std::vector<Entry<MetricCounter>>   mCounters;
+    std::vector<Entry<MetricGauge>>     mGauges;
+    std::vector<Entry<MetricHistogram>> mHistograms;
+    // exporter
+    std::string     mFile;
+    std::string     mSocket;
+    UINT            mInterval;
+    std::thread    *mThread;
+    std::atomic<bool> mStop;
+    std::condition_variable mStopCond;
+    std::mutex      mStopSync;
+
+public:
+    // singleton
+    static Metrics &get();
+    // register metrics, same name and labels return the same metric
+    MetricCounter  *counter(const std::string &name,const std::string &labels,const std::string &help);
+    MetricGauge    *gauge(const std::string &name,const std::string &labels,const std::string &help);
+    MetricHistogram *histogram(const std::string &name,const std::string &labels,const std::string &help);
+    // export to file and local socket every interval ms, empty path disables target
+    bool            init(const std::string &file,const std::string &socket,UINT interval);
+    void            shutdown();
+    // Prometheus text format
+    std::string     format();
+
+private:
+    // ctor/dtor
+    Metrics();
+    ~Metrics();
+    // find or create entry
+    template<class T>
+    T              *find(std::vector<Entry<T>> &list,const std::string &name,const std::string &labels,const std::string &help);
+    // exporter thread
+    static void     funcWrapExport(void *param);
+    void            runExport();
+    bool            writeFile(const std::string &text);
+};
@@ -0,0 +1,595 @@
+//////////////////////////////////////////////////////////////////////////
+// MySQLSession.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "MySQLSession.h"
+#include "AsyncLogger.h"
+#include <errmsg.h>
+
+//////////////////////////////////////////////////////////////////////////
+// commit traits: stored procedure, row description and success logging
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+struct MySQLTraits;
+
+template<>
+struct MySQLTraits<TransQuote>
+{
+    enum { LOGGED=0 };
+    static const char *type() { return("quote"); }
+    static std::string proc() { return(PROC_UPDATE_PRICE); }
+    static soci::procedure *prepare(soci::session &sql,TransQuote &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransQuote &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"'%s' quote",trans.data.symbol); }
+};
+template<>
+struct MySQLTraits<TransTrade>
+{
+    enum { LOGGED=1 };
+    static const char *type() { return("trade"); }
+    static std::string proc() { return(PROC_UPDATE_TRADE); }
+    static soci::procedure *prepare(soci::session &sql,TransTrade &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransTrade &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"trade '%d'",trans.data.order); }
+};
+template<>
+struct MySQLTraits<TransUser>
+{
+    enum { LOGGED=1 };
+    static const char *type() { return("user"); }
+    static std::string proc() { return(PROC_UPDATE_USER); }
+    static soci::procedure *prepare(soci::session &sql,TransUser &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransUser &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"user '#%d'",trans.data.login); }
+};
+template<>
+struct MySQLTraits<TransSymbol>
+{
+    enum { LOGGED=1 };
+    static const char *type() { return("symbol"); }
+    static std::string proc() { return(PROC_UPDATE_SYMBOL); }
+    static soci::procedure *prepare(soci::session &sql,TransSymbol &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransSymbol &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"'%s' symbol",trans.data.symbol); }
+};
+template<>
+struct MySQLTraits<TransGroup>
+{
+    enum { LOGGED=1 };
+    static const char *type() { return("group"); }
+    static std::string proc() { return(PROC_UPDATE_GROUP); }
+    static soci::procedure *prepare(soci::session &sql,TransGroup &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransGroup &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"'%s' group",trans.data.group); }
+};
+template<>
+struct MySQLTraits<TransSymbolGroup>
+{
+    enum { LOGGED=1 };
+    static const char *type() { return("symbol group"); }
+    static std::string proc() { return(PROC_UPDATE_SYMBOLGROUP); }
+    static soci::procedure *prepare(soci::session &sql,TransSymbolGroup &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransSymbolGroup &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"'%s' symbol group",trans.data.name); }
+};
+template<>
+struct MySQLTraits<TransMargin>
+{
+    enum { LOGGED=0 };
+    static const char *type() { return("margin level"); }
+    static std::string proc() { return(PROC_UPDATE_MARGIN); }
+    static soci::procedure *prepare(soci::session &sql,TransMargin &row) { return(new soci::procedure((sql.prepare << proc(),soci::use(row)))); }
+    static void describe(const TransMargin &trans,char *buf,size_t size) { _snprintf_s(buf,size,_TRUNCATE,"user '#%d' margin level",trans.data.login); }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+MySQLSession::MySQLSession(const std::string &srvc,int index)
+    : DatabaseSession(srvc,index)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+MySQLSession::~MySQLSession()
+{
+    // lock
+    mSync.lock();
+    // close session
+    disconnect();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// connect to db
+//////////////////////////////////////////////////////////////////////////
+bool MySQLSession::connect(const std::string &conn)
+{
+    // lock
+    mSync.lock();
+    // disconnect first
+    disconnect();
+    // create session
+    try
+    {
+        // open db connection
+        mSQL.open(conn);
+        // prepare stored proc-s, session without statements is useless
+        if(!prepare())
+        {
+            disconnect();
+            mSync.unlock();
+            return(false);
+        }
+        // batches send several calls per round trip
+        if(mysql_set_server_option(handle(),MYSQL_OPTION_MULTI_STATEMENTS_ON)!=0)
+        {
+            Logger::get().log("'%s': session #%d failed to enable multi statements [%s]",mSrvc.c_str(),mIndex,mysql_error(handle()));
+            disconnect();
+            mSync.unlock();
+            return(false);
+        }
+    }
+    catch(soci::mysql_soci_error &e)
+    {
+        Logger::get().log("'%s': failed to create mysql session #%d [%s]",mSrvc.c_str(),mIndex,e.what());
+        mSync.unlock();
+        return(false);
+    }
+    catch(soci::soci_error &e)
+    {
+        Logger::get().log("'%s': failed to create sql session #%d [%s]",mSrvc.c_str(),mIndex,e.what());
+        mSync.unlock();
+        return(false);
+    }
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// ping session
+//////////////////////////////////////////////////////////////////////////
+bool MySQLSession::connected()
+{
+    int res=0;
+    // lock
+    mSync.lock();
+    // get mysql connection
+    MYSQL *conn=handle();
+    if(conn==nullptr)
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // ping mysql
+    res=mysql_ping(conn);
+    // unlock
+    mSync.unlock();
+    // check mysql state
+    if(res)
+    {
+        Logger::get().log("'%s': session #%d connection to mysql server has been lost, reconnecting.. [%d]",mSrvc.c_str(),mIndex,res);
+        return(false);
+    }
+    // connected
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// single row commit
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool MySQLSession::commit(const T *trans)
+{
+    Statement<T> &stmt=statement(trans);
+    char          desc[128];
+    bool          res=false;
+    // checks
+    if(trans==nullptr)
+        return(false);
+    // lock
+    mSync.lock();
+    // check
+    if(stmt.proc==nullptr)
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // copy data into bound row
+    memcpy(&stmt.row,trans,sizeof(T));
+    // execute procedure
+    try
+    {
+        res=stmt.proc->execute(true);
+    }
+    catch(soci::soci_error &e)
+    {
+        mSync.unlock();
+        MySQLTraits<T>::describe(*trans,desc,sizeof(desc));
+        Logger::get().log("'%s': failed to commit %s [%s]",mSrvc.c_str(),desc,e.what());
+        return(false);
+    }
+    // unlock
+    mSync.unlock();
+    // log info
+    if(MySQLTraits<T>::LOGGED)
+    {
+        MySQLTraits<T>::describe(*trans,desc,sizeof(desc));
+        AsyncLogger::get().log("'%s': committed %s",mSrvc.c_str(),desc);
+    }
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// batch commit
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t MySQLSession::commitBatch(const T *trans,size_t count,bool *results)
+{
+    Statement<T>       &stmt=statement(trans);
+    const char         *type=MySQLTraits<T>::type();
+    size_t              committed=0,pos=0;
+    bool                lost=false;
+    std::string         sql;
+    std::vector<size_t> rows;
+    // checks
+    if(trans==nullptr || count==0)
+        return(0);
+    // reset results
+    if(results)
+        for(size_t i=0;i<count;i++)
+            results[i]=false;
+    // lock
+    mSync.lock();
+    // check
+    MYSQL *conn=handle();
+    if(stmt.proc==nullptr || conn==nullptr)
+    {
+        mSync.unlock();
+        return(0);
+    }
+    // open transaction
+    try
+    {
+        mSQL.begin();
+    }
+    catch(soci::soci_error &e)
+    {
+        Logger::get().log("'%s': failed to begin %s batch [%s]",mSrvc.c_str(),type,e.what());
+        mSync.unlock();
+        return(0);
+    }
+    // send calls in as few round trips as possible, failed row does not drop the batch
+    sql.reserve(BATCH_BYTES+4096);
+    while(pos<count && !lost)
+    {
+        size_t done=0;
+        // calls of round trip
+        sql.clear();
+        rows.clear();
+        for(;pos<count && sql.size()<BATCH_BYTES;pos++)
+        {
+            size_t len=sql.size();
+            if(!format(conn,stmt,trans[pos],sql))
+            {
+                sql.resize(len);
+                Logger::get().log("'%s': failed to format %s row %u of %u",mSrvc.c_str(),type,(unsigned)pos+1,(unsigned)count);
+                continue;
+            }
+            sql+=';';
+            rows.push_back(pos);
+        }
+        if(rows.empty())
+            continue;
+        // execute
+        bool res=execute(conn,sql,done);
+        for(size_t i=0;i<done && i<rows.size();i++)
+        {
+            if(results)
+                results[rows[i]]=true;
+            committed++;
+        }
+        if(res || done>=rows.size())
+            continue;
+        // calls after failed one were not executed, resume behind it
+        Logger::get().log("'%s': failed to commit %s row %u of %u [%s]",mSrvc.c_str(),type,(unsigned)rows[done]+1,(unsigned)count,mysql_error(conn));
+        lost=(mysql_errno(conn)==CR_SERVER_GONE_ERROR || mysql_errno(conn)==CR_SERVER_LOST);
+        pos=rows[done]+1;
+    }
+    // commit transaction
+    try
+    {
+        mSQL.commit();
+    }
+    catch(soci::soci_error &e)
+    {
+        Logger::get().log("'%s': failed to commit %s batch [%s]",mSrvc.c_str(),type,e.what());
+        // whole batch is lost
+        try { mSQL.rollback(); } catch(soci::soci_error&) {}
+        if(results)
+            for(size_t i=0;i<count;i++)
+                results[i]=false;
+        mSync.unlock();
+        return(0);
+    }
+    // unlock
+    mSync.unlock();
+    // log info
+    AsyncLogger::get().log("'%s': committed %u of %u %s rows",mSrvc.c_str(),(unsigned)committed,(unsigned)count,type);
+    // result
+    return(committed);
+}
+//////////////////////////////////////////////////////////////////////////
+// append procedure call with row values as literals
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool MySQLSession::format(MYSQL *conn,Statement<T> &stmt,const T &trans,std::string &sql)
+{
+    soci::values    values;
+    soci::indicator ind=soci::i_ok;
+    // checks
+    if(stmt.text.empty())
+        return(false);
+    try
+    {
+        // same conversion as used by prepared procedure
+        soci::type_conversion<T>::to_base(trans,values,ind);
+        // text and values
+        for(size_t i=0;i<stmt.names.size();i++)
+        {
+            sql+=stmt.text[i];
+            if(!literal(conn,values,stmt.names[i],stmt.kinds[i],sql))
+                return(false);
+        }
+        sql+=stmt.text.back();
+    }
+    catch(std::exception &e)
+    {
+        Logger::get().log("'%s': failed to convert %s row [%s]",mSrvc.c_str(),MySQLTraits<T>::type(),e.what());
+        return(false);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// append value as SQL literal
+//////////////////////////////////////////////////////////////////////////
+bool MySQLSession::literal(MYSQL *conn,const soci::values &values,const std::string &name,int &kind,std::string &sql)
+{
+    char buf[64];
+    // null
+    if(values.get_indicator(name)==soci::i_null)
+    {
+        sql+="NULL";
+        return(true);
+    }
+    // learn kind once
+    if(kind==VALUE_UNKNOWN && (kind=MySQLSession::kind(values,name))==VALUE_UNKNOWN)
+    {
+        Logger::get().log("'%s': unsupported type of '%s' value",mSrvc.c_str(),name.c_str());
+        return(false);
+    }
+    // format
+    switch(kind)
+    {
+        case VALUE_STRING:
+        {
+            const std::string value=values.get<std::string>(name);
+            std::vector<char> escaped(value.size()*2+1);
+            sql+='\'';
+            sql.append(&escaped[0],mysql_real_escape_string(conn,&escaped[0],value.c_str(),(unsigned long)value.size()));
+            sql+='\'';
+            return(true);
+        }
+        case VALUE_INT:
+            _snprintf_s(buf,_countof(buf),_TRUNCATE,"%d",values.get<int>(name));
+            break;
+        case VALUE_LONG:
+            _snprintf_s(buf,_countof(buf),_TRUNCATE,"%I64d",(INT64)values.get<long long>(name));
+            break;
+        case VALUE_ULONG:
+            _snprintf_s(buf,_countof(buf),_TRUNCATE,"%I64u",(UINT64)values.get<unsigned long long>(name));
+            break;
+        case VALUE_DOUBLE:
+        {
+            double value=values.get<double>(name);
+            if(!_finite(value))
+            {
+                sql+="NULL";
+                return(true);
+            }
+            _snprintf_s(buf,_countof(buf),_TRUNCATE,"%.17g",value);
+            break;
+        }
+        case VALUE_DATE:
+        {
+            const std::tm value=values.get<std::tm>(name);
+            _snprintf_s(buf,_countof(buf),_TRUNCATE,"'%04d-%02d-%02d %02d:%02d:%02d'",value.tm_year+1900,value.tm_mon+1,value.tm_mday,value.tm_hour,value.tm_min,value.tm_sec);
+            break;
+        }
+        default:
+            return(false);
+    }
+    sql+=buf;
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// kind of bound value, soci throws on type mismatch
+//////////////////////////////////////////////////////////////////////////
+int MySQLSession::kind(const soci::values &values,const std::string &name)
+{
+    try { values.get<std::string>(name);        return(VALUE_STRING); } catch(std::exception&) {}
+    try { values.get<int>(name);                return(VALUE_INT);    } catch(std::exception&) {}
+    try { values.get<long long>(name);          return(VALUE_LONG);   } catch(std::exception&) {}
+    try { values.get<unsigned long long>(name); return(VALUE_ULONG);  } catch(std::exception&) {}
+    try { values.get<double>(name);             return(VALUE_DOUBLE); } catch(std::exception&) {}
+    try { values.get<std::tm>(name);            return(VALUE_DATE);   } catch(std::exception&) {}
+    return(VALUE_UNKNOWN);
+}
+//////////////////////////////////////////////////////////////////////////
+// split procedure text by ':name' placeholders
+//////////////////////////////////////////////////////////////////////////
+void MySQLSession::parse(const std::string &proc,std::vector<std::string> &text,std::vector<std::string> &names)
+{
+    std::string part;
+    char        quote=0;
+    // procedure call statement
+    size_t start=proc.find_first_not_of(" \t\r\n");
+    if(start==std::string::npos || _strnicmp(proc.c_str()+start,"call",4)!=0)
+        part="CALL ";
+    // placeholders outside of string literals
+    for(size_t i=0;i<proc.size();i++)
+    {
+        char c=proc[i];
+        if(quote)
+        {
+            if(c==quote)
+                quote=0;
+        }
+        else
+            if(c=='\'' || c=='"')
+                quote=c;
+            else
+                if(c==':' && i+1<proc.size() && (isalnum((unsigned char)proc[i+1]) || proc[i+1]=='_'))
+                {
+                    size_t end=i+1;
+                    while(end<proc.size() && (isalnum((unsigned char)proc[end]) || proc[end]=='_'))
+                        end++;
+                    text.push_back(part);
+                    names.push_back(proc.substr(i+1,end-i-1));
+                    part.clear();
+                    i=end-1;
+                    continue;
+                }
+        part+=c;
+    }
+    text.push_back(part);
+}
+//////////////////////////////////////////////////////////////////////////
+// execute statements and read all results
+//////////////////////////////////////////////////////////////////////////
+bool MySQLSession::execute(MYSQL *conn,const std::string &sql,size_t &done)
+{
+    done=0;
+    // send
+    int status=mysql_real_query(conn,sql.data(),(unsigned long)sql.size());
+    // every statement ends with result without fields, procedures may return result sets before it
+    while(status==0)
+    {
+        MYSQL_RES *res=mysql_store_result(conn);
+        if(res)
+            mysql_free_result(res);
+        else
+            if(mysql_field_count(conn)==0)
+                done++;
+        status=mysql_next_result(conn);
+    }
+    // -1 when all results are read, statement failed otherwise
+    return(status<0);
+}
+//////////////////////////////////////////////////////////////////////////
+// native connection of session
+//////////////////////////////////////////////////////////////////////////
+MYSQL *MySQLSession::handle()
+{
+    soci::mysql_session_backend *session=static_cast<soci::mysql_session_backend*>(mSQL.get_backend());
+    return(session ? session->conn_ : nullptr);
+}
+//////////////////////////////////////////////////////////////////////////
+// commits
+//////////////////////////////////////////////////////////////////////////
+bool MySQLSession::commitQuote(const TransQuote *trans,int sid)             { return(commit(trans)); }
+bool MySQLSession::commitTrade(const TransTrade *trans,int sid)             { return(commit(trans)); }
+bool MySQLSession::commitUser(const TransUser *trans,int sid)               { return(commit(trans)); }
+bool MySQLSession::commitSymbol(const TransSymbol *trans,int sid)           { return(commit(trans)); }
+bool MySQLSession::commitGroup(const TransGroup *trans,int sid)             { return(commit(trans)); }
+bool MySQLSession::commitSymbolGroup(const TransSymbolGroup *trans,int sid) { return(commit(trans)); }
+bool MySQLSession::commitMargin(const TransMargin *trans,int sid)           { return(commit(trans)); }
+//////////////////////////////////////////////////////////////////////////
+// batch commits
+//////////////////////////////////////////////////////////////////////////
+size_t MySQLSession::commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)             { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)             { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)               { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)           { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)             { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results) { return(commitBatch(trans,count,results)); }
+size_t MySQLSession::commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)           { return(commitBatch(trans,count,results)); }
+////////////////////////////////////////////////////////////////////////
+// prepare procedure, throws soci errors
+////////////////////////////////////////////////////////////////////////
+template<class T>
+bool MySQLSession::prepare(Statement<T> &stmt)
+{
+    stmt.proc=MySQLTraits<T>::prepare(mSQL,stmt.row);
+    // batch text
+    stmt.text.clear();
+    stmt.names.clear();
+    parse(MySQLTraits<T>::proc(),stmt.text,stmt.names);
+    stmt.kinds.assign(stmt.names.size(),VALUE_UNKNOWN);
+    return(stmt.proc!=nullptr);
+}
+////////////////////////////////////////////////////////////////////////
+// prepare procedures
+////////////////////////////////////////////////////////////////////////
+bool MySQLSession::prepare()
+{
+    // logout
+    Logger::get().log("'%s': session #%d preparing stored functions",mSrvc.c_str(),mIndex);
+    try
+    {
+        // create procedures
+        if(!prepare(mQuote) || !prepare(mUser) || !prepare(mTrade) || !prepare(mSymbol) ||
+           !prepare(mGroup) || !prepare(mSymbolGroup) || !prepare(mMargin))
+        {
+            Logger::get().log("'%s': session #%d failed to prepare stored functions",mSrvc.c_str(),mIndex);
+            return(false);
+        }
+    }
+    catch(soci::mysql_soci_error &e)
+    {
+        Logger::get().log("'%s': failed to prepare mysql stored functions [%s]",mSrvc.c_str(),e.what());
+        return(false);
+    }
+    catch(soci::soci_error &e)
+    {
+        Logger::get().log("'%s': failed to prepare database objects [%s]",mSrvc.c_str(),e.what());
+        return(false);
+    }
+    // success
+    return(true);
+}
+////////////////////////////////////////////////////////////////////////
+// release procedure
+////////////////////////////////////////////////////////////////////////
+template<class T>
+void MySQLSession::release(Statement<T> &stmt)
+{
+    if(stmt.proc)
+    {
+        delete(stmt.proc);
+        stmt.proc=nullptr;
+    }
+}
+////////////////////////////////////////////////////////////////////////
+// release CLOBs and procedures
+////////////////////////////////////////////////////////////////////////
+void MySQLSession::release()
+{
+    // logout
+    Logger::get().log("'%s': session #%d releasing stored functions",mSrvc.c_str(),mIndex);
+    // release func's
+    release(mQuote);
+    release(mUser);
+    release(mTrade);
+    release(mSymbol);
+    release(mGroup);
+    release(mSymbolGroup);
+    release(mMargin);
+}
+//////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////
+void MySQLSession::disconnect()
+{
+    // release procedures and blobs
+    release();
+    // close connections
+    mSQL.close();
+}
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////
+// MySQLSession.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "DatabaseSession.h"
+
+//////////////////////////////////////////////////////////////////////////
+// MySQL session with its own procedures and row buffers
+//////////////////////////////////////////////////////////////////////////
+class MySQLSession : public DatabaseSession
+{
+private:
+    // constants
+    enum constants
+    {
+        BATCH_BYTES=1024*1024           // max statements text per round trip
+    };
+    // kinds of bound values
+    enum EnValue
+    {
+        VALUE_UNKNOWN=-1,
+        VALUE_STRING =0,
+        VALUE_INT    =1,
+        VALUE_LONG   =2,
+        VALUE_ULONG  =3,
+        VALUE_DOUBLE =4,
+        VALUE_DATE   =5
+    };
+    // prepared procedure with its row buffer, soci binds buffer address at prepare time,
+    // batches send procedure text with literals, several calls per round trip
+    template<class T>
+    struct Statement
+    {
+        soci::procedure *proc;
+        T                row;
+        std::vector<std::string> text;      // procedure text around placeholders
+        std::vector<std::string> names;     // placeholders
+        std::vector<int>         kinds;     // value kinds, learned from first row
+        Statement() : proc(nullptr) {}
+    };
+
+private:
+    // transactions lock
+    std::mutex          mSync;
+    // database session
+    soci::session       mSQL;
+    // database procedures
+    Statement<TransQuote>       mQuote;
+    Statement<TransTrade>       mTrade;
+    Statement<TransUser>        mUser;
+    Statement<TransSymbol>      mSymbol;
+    Statement<TransGroup>       mGroup;
+    Statement<TransSymbolGroup> mSymbolGroup;
+    Statement<TransMargin>      mMargin;
+
+public:
+    // ctor/dtor
+    MySQLSession(const std::string &srvc,int index);
+    virtual ~MySQLSession();
+    // connect
+    virtual bool    connect(const std::string &conn);
+    virtual bool    connected();
+    // commit transactions, procedures key rows themselves, sid is not stored
+    virtual bool    commitQuote(const TransQuote *trans,int sid);
+    virtual bool    commitTrade(const TransTrade *trans,int sid);
+    virtual bool    commitUser(const TransUser *trans,int sid);
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid);
+    virtual bool    commitGroup(const TransGroup *trans,int sid);
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid);
+    virtual bool    commitMargin(const TransMargin *trans,int sid);
+    // batch commit transactions, one SQL transaction per batch, returns number of committed rows
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results);
+
+private:
+    // statement by transaction type
+    Statement<TransQuote>       &statement(const TransQuote*)       { return(mQuote);       }
+    Statement<TransTrade>       &statement(const TransTrade*)       { return(mTrade);       }
+    Statement<TransUser>        &statement(const TransUser*)        { return(mUser);        }
+    Statement<TransSymbol>      &statement(const TransSymbol*)      { return(mSymbol);      }
+    Statement<TransGroup>       &statement(const TransGroup*)       { return(mGroup);       }
+    Statement<TransSymbolGroup> &statement(const TransSymbolGroup*) { return(mSymbolGroup); }
+    Statement<TransMargin>      &statement(const TransMargin*)      { return(mMargin);      }
+    // single row and batch commit of any transaction type
+    template<class T>
+    bool            commit(const T *trans);
+    template<class T>
+    size_t          commitBatch(const T *trans,size_t count,bool *results);
+    // batch statements text
+    template<class T>
+    bool            format(MYSQL *conn,Statement<T> &stmt,const T &trans,std::string &sql);
+    bool            literal(MYSQL *conn,const soci::values &values,const std::string &name,int &kind,std::string &sql);
+    static int      kind(const soci::values &values,const std::string &name);
+    static void     parse(const std::string &proc,std::vector<std::string> &text,std::vector<std::string> &names);
+    // execute statements in one round trip, returns number of completed ones
+    static bool     execute(MYSQL *conn,const std::string &sql,size_t &done);
+    // native connection
+    MYSQL          *handle();
+    // stored procedures
+    template<class T>
+    bool            prepare(Statement<T> &stmt);
+    template<class T>
+    void            release(Statement<T> &stmt);
+    void            release();
+    bool            prepare();
+    // disconnect
+    void            disconnect();
+};
@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////
+// ObjectPool.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "RingQueue.h"
+
+//////////////////////////////////////////////////////////////////////////
+// objects pool with lock-free free list and cross-thread release
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+class ObjectPool
+{
+public:
+    // counters
+    struct Stats
+    {
+        UINT64      hits;           // allocations served from free list
+        UINT64      misses;         // allocations served from heap
+        UINT64      drops;          // releases freed to heap, free list was full
+        UINT64      used;           // objects currently allocated
+        UINT64      highwater;      // max objects allocated at once
+    };
+
+private:
+    // free objects
+    RingQueue<T*>   mFree;
+    // counters
+    std::atomic<UINT64> mHits;
+    std::atomic<UINT64> mMisses;
+    std::atomic<UINT64> mDrops;
+    std::atomic<UINT64> mUsed;
+    std::atomic<UINT64> mHighwater;
+
+public:
+    // ctor/dtor
+    ObjectPool() : mHits(0),mMisses(0),mDrops(0),mUsed(0),mHighwater(0) {}
+    ~ObjectPool()
+    {
+        T *obj;
+        // free cached objects
+        while(mFree.tryPop(obj))
+            delete(obj);
+    }
+    // init with free list capacity and number of preallocated objects
+    bool init(size_t capacity,size_t prealloc)
+    {
+        // create free list
+        if(!mFree.init(capacity,RingQueue<T*>::WAIT_SPIN))
+            return(false);
+        // preallocate
+        for(size_t i=0;i<prealloc && i<mFree.capacity();i++)
+            mFree.tryPush(new T());
+        // success
+        return(true);
+    }
+    // get object, content of reused object is not reset
+    T *alloc()
+    {
+        T *obj=nullptr;
+        // try free list first
+        if(mFree.tryPop(obj))
+            mHits.fetch_add(1,std::memory_order_relaxed);
+        else
+        {
+            obj=new T();
+            mMisses.fetch_add(1,std::memory_order_relaxed);
+        }
+        // update high-water mark
+        UINT64 used=mUsed.fetch_add(1,std::memory_order_relaxed)+1;
+        UINT64 high=mHighwater.load(std::memory_order_relaxed);
+        while(used>high && !mHighwater.compare_exchange_weak(high,used,std::memory_order_relaxed))
+            ;
+        // result
+        return(obj);
+    }
+    // return object from any thread
+    void release(T *obj)
+    {
+        // checks
+        if(obj==nullptr)
+            return;
+        mUsed.fetch_sub(1,std::memory_order_relaxed);
+        // free list is full
+        if(!mFree.tryPush(obj))
+        {
+            mDrops.fetch_add(1,std::memory_order_relaxed);
+            delete(obj);
+        }
+    }
+    // counters
+    Stats stats() const
+    {
+        Stats res;
+        res.hits     =mHits.load(std::memory_order_relaxed);
+        res.misses   =mMisses.load(std::memory_order_relaxed);
+        res.drops    =mDrops.load(std::memory_order_relaxed);
+        res.used     =mUsed.load(std::memory_order_relaxed);
+        res.highwater=mHighwater.load(std::memory_order_relaxed);
+        return(res);
+    }
+};
@@ -0,0 +1,176 @@
+//////////////////////////////////////////////////////////////////////////
+// QuoteConflator.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "QuoteConflator.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+QuoteConflator::QuoteConflator()
+    : mInterval(1000),
+      mDepth(0),
+      mFlushTime(std::chrono::steady_clock::now())
+{
+    memset(&mStats,0,sizeof(mStats));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+QuoteConflator::~QuoteConflator()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// init
+//////////////////////////////////////////////////////////////////////////
+void QuoteConflator::init(UINT interval,UINT depth)
+{
+    // lock
+    mSync.lock();
+    // copy params
+    mInterval =interval;
+    mDepth    =depth;
+    mFlushTime=std::chrono::steady_clock::now();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// add quote
+//////////////////////////////////////////////////////////////////////////
+bool QuoteConflator::push(const TransQuote *trans,int sid)
+{
+    bool res;
+    // checks
+    if(trans==nullptr)
+        return(false);
+    std::string symbol(trans->data.symbol);
+    // lock
+    mSync.lock();
+    // replace previous tick
+    mQuotes[symbol]=*trans;
+    mSIDs[symbol]  =sid;
+    mStats.received++;
+    // previous tick was not flushed yet
+    if(!mDirty.insert(symbol).second)
+        mStats.coalesced++;
+    // check depth threshold
+    res=(mDepth>0 && mDirty.size()>=mDepth);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// check thresholds
+//////////////////////////////////////////////////////////////////////////
+bool QuoteConflator::due()
+{
+    bool res;
+    // lock
+    mSync.lock();
+    // nothing to flush
+    if(mDirty.empty())
+    {
+        mSync.unlock();
+        return(false);
+    }
+    // depth or interval reached
+    res=(mDepth>0 && mDirty.size()>=mDepth) ||
+        std::chrono::steady_clock::now()-mFlushTime>=std::chrono::milliseconds(mInterval);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit dirty quotes
+//////////////////////////////////////////////////////////////////////////
+size_t QuoteConflator::flush(const std::vector<Database*> &databases)
+{
+    std::vector<TransQuote> quotes;
+    std::vector<int>        sids;
+    // serialize flushes, taken before quotes lock
+    mFlushSync.lock();
+    // lock
+    mSync.lock();
+    // take snapshot of dirty symbols
+    quotes.reserve(mDirty.size());
+    sids.reserve(mDirty.size());
+    for(auto &it : mDirty)
+    {
+        quotes.push_back(mQuotes[it]);
+        sids.push_back(mSIDs[it]);
+    }
+    mDirty.clear();
+    mFlushTime=std::chrono::steady_clock::now();
+    // unlock
+    mSync.unlock();
+    // checks
+    if(quotes.empty())
+    {
+        mFlushSync.unlock();
+        return(0);
+    }
+    // commit to every database
+    std::unique_ptr<bool[]> results(new bool[quotes.size()]);
+    std::vector<bool>       failed(quotes.size(),false);
+    for(auto db : databases)
+    {
+        if(db->commitQuotes(quotes.data(),sids.data(),quotes.size(),results.get())==quotes.size())
+            continue;
+        for(size_t i=0;i<quotes.size();i++)
+            if(!results[i])
+                failed[i]=true;
+    }
+    // lock
+    mSync.lock();
+    // keep failed symbols dirty unless a newer tick already did it
+    size_t flushed=0;
+    for(size_t i=0;i<quotes.size();i++)
+        if(failed[i])
+            mDirty.insert(quotes[i].data.symbol);
+        else
+            flushed++;
+    mStats.flushed+=flushed;
+    mStats.flushes++;
+    // unlock
+    mSync.unlock();
+    mFlushSync.unlock();
+    // result
+    return(flushed);
+}
+//////////////////////////////////////////////////////////////////////////
+// latest quote of symbol
+//////////////////////////////////////////////////////////////////////////
+bool QuoteConflator::get(const std::string &symbol,TransQuote &quote)
+{
+    // lock
+    mSync.lock();
+    // find symbol
+    QuotesMap::const_iterator it=mQuotes.find(symbol);
+    if(it==mQuotes.end())
+    {
+        mSync.unlock();
+        return(false);
+    }
+    quote=it->second;
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// counters
+//////////////////////////////////////////////////////////////////////////
+QuoteConflator::Stats QuoteConflator::stats()
+{
+    Stats res;
+    // lock
+    mSync.lock();
+    res=mStats;
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
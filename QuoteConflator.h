@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+// QuoteConflator.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Database.h"
+
+//////////////////////////////////////////////////////////////////////////
+// type definitions
+//////////////////////////////////////////////////////////////////////////
+typedef std::map<std::string,TransQuote> QuotesMap;
+
+//////////////////////////////////////////////////////////////////////////
+// keeps only the newest quote per symbol until flush
+//////////////////////////////////////////////////////////////////////////
+class QuoteConflator
+{
+public:
+    // counters
+    struct Stats
+    {
+        UINT64      received;       // ticks pushed
+        UINT64      coalesced;      // ticks replaced by newer tick before flush
+        UINT64      flushed;        // quotes sent to databases
+        UINT64      flushes;        // flush calls with dirty symbols
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // one flush at a time, concurrent flushes could commit older tick of symbol after newer one
+    std::mutex      mFlushSync;
+    // latest quote per symbol
+    QuotesMap       mQuotes;
+    // server of latest quote, goes to change log
+    std::map<std::string,int> mSIDs;
+    // symbols changed since last flush
+    std::set<std::string> mDirty;
+    // flush thresholds
+    UINT            mInterval;
+    UINT            mDepth;
+    std::chrono::steady_clock::time_point mFlushTime;
+    // counters
+    Stats           mStats;
+
+public:
+    // ctor/dtor
+    QuoteConflator();
+    ~QuoteConflator();
+    // init with flush interval (ms) and dirty symbols threshold
+    void            init(UINT interval,UINT depth);
+    // add quote of server, returns true if flush is due
+    bool            push(const TransQuote *trans,int sid=0);
+    // check thresholds
+    bool            due();
+    // commit dirty quotes to databases, failed symbols stay dirty, flushes are serialized
+    size_t          flush(const std::vector<Database*> &databases);
+    // latest quote of symbol
+    bool            get(const std::string &symbol,TransQuote &quote);
+    // counters
+    Stats           stats();
+};
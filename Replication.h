@@ -4,17 +4,25 @@
 //////////////////////////////////////////////////////////////////////////
 #pragma once
 #include "Config.h"
+#include "ConfigWatcher.h"
 #include "Manager.h"
 #include "Database.h"
+#include "QuoteConflator.h"
+#include "MarginCache.h"
+#include "DedupCache.h"
 #include "Workpool.h"
+#include "Backpressure.h"
+#include "DatabaseTarget.h"
+#include "FlushScheduler.h"
 
 //////////////////////////////////////////////////////////////////////////
 // type definitions
 //////////////////////////////////////////////////////////////////////////
 typedef std::vector<Manager*>            ManagerArray;
 typedef std::vector<Database*>           DatabaseArray;
+typedef std::vector<DatabaseTarget*>     DatabaseTargetArray;
+typedef std::vector<FlushScheduler*>     FlushSchedulerArray;
 typedef Workpool<TransGeneric*>          TransQueue;
-typedef std::map<std::string,TransQuote> QuotesMap;
 typedef std::map<int,TransMargin>        TransMarginMap;
 
 //////////////////////////////////////////////////////////////////////////
@@ -25,17 +33,33 @@ class Replication
 private:
     // servers config
     Config          mConfig;
+    // config reload, starts/stops only changed managers and databases
+    ConfigWatcher   mWatcher;
     // MT5 managers
     ManagerArray    mManagers;
     // SQL databases
     DatabaseArray   mDatabases;
+    // per-database delivery after consume, first database is primary
+    DatabaseTargetArray mTargets;
+    // per-database group commit of consumed transactions
+    FlushSchedulerArray mSchedulers;
+    // committed transactions for local consumers
+    ChangeLog       mChangeLog;
     // working dir
     std::string     mWorkPath;
     // transactions queue
     TransQueue      mQueue;
+    // watermarks and load shedding of transactions queue
+    Backpressure    mBackpressure;
     // quotes
     QuotesMap       mQuotes;
     TransMarginMap  mMargins;
+    // last written margin levels
+    MarginCache     mMarginCache;
+    // last written users, symbols and groups
+    DedupCache      mDedup;
+    // quotes conflation before databases
+    QuoteConflator  mConflator;
     // thread pool
     std::vector<std::thread*> mThreads;
 
@@ -0,0 +1,282 @@
+//////////////////////////////////////////////////////////////////////////
+// RingQueue.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// bounded lock-free multi-producer/multi-consumer queue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+class RingQueue
+{
+public:
+    // wait policies for empty/full queue
+    enum EnWaitPolicy
+    {
+        WAIT_SPIN =0,               // busy loop
+        WAIT_YIELD=1,               // give up time slice
+        WAIT_BLOCK=2                // sleep on condition variable
+    };
+
+private:
+    // queue cell
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T               data;
+    };
+    // ring
+    std::unique_ptr<Cell[]> mCells;
+    size_t          mMask;
+    int             mPolicy;
+    // producer/consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+    // blocking wait
+    alignas(64) std::atomic<int> mWaiters;
+    std::atomic<bool> mShutdown;
+    std::mutex      mWaitSync;
+    std::condition_variable mWaitCond;
+
+public:
+    // ctor/dtor
+    RingQueue() : mMask(0),mPolicy(WAIT_BLOCK),mHead(0),mTail(0),mWaiters(0),mShutdown(false) {}
+    ~RingQueue() {}
+    // init with capacity (rounded up to power of two) and wait policy
+    bool            init(size_t capacity,int policy=WAIT_BLOCK);
+    // stop waiting consumers/producers
+    void            shutdown();
+    // enqueue, waits for free cell unless queue is shut down
+    bool            push(const T &item);
+    bool            tryPush(const T &item);
+    // dequeue, waits up to timeout ms for data
+    bool            pop(T &item,UINT timeout=INFINITE);
+    bool            tryPop(T &item);
+    // approximate number of items
+    size_t          size() const;
+    size_t          capacity() const { return(mMask+1); }
+
+private:
+    // wait step for policy, pop waits for data, push for free cell
+    void            wait(bool pop,std::chrono::steady_clock::time_point deadline);
+    void            wake();
+    // next cell is ready for pop or push
+    bool            ready(bool pop) const;
+};
+//////////////////////////////////////////////////////////////////////////
+// init
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::init(size_t capacity,int policy)
+{
+    size_t size=2;
+    // checks
+    if(capacity<2 || mCells)
+        return(false);
+    // round up to power of two
+    while(size<capacity)
+        size<<=1;
+    // allocate cells
+    mCells.reset(new Cell[size]);
+    for(size_t i=0;i<size;i++)
+        mCells[i].seq.store(i,std::memory_order_relaxed);
+    mMask  =size-1;
+    mPolicy=policy;
+    mHead.store(0,std::memory_order_relaxed);
+    mTail.store(0,std::memory_order_relaxed);
+    mShutdown.store(false);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void RingQueue<T>::shutdown()
+{
+    mShutdown.store(true);
+    // wake everybody
+    std::lock_guard<std::mutex> lock(mWaitSync);
+    mWaitCond.notify_all();
+}
+//////////////////////////////////////////////////////////////////////////
+// try enqueue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::tryPush(const T &item)
+{
+    Cell  *cell;
+    size_t pos=mTail.load(std::memory_order_relaxed);
+    // checks
+    if(!mCells)
+        return(false);
+    // find free cell
+    for(;;)
+    {
+        cell=&mCells[pos&mMask];
+        size_t   seq =cell->seq.load(std::memory_order_acquire);
+        intptr_t diff=(intptr_t)seq-(intptr_t)pos;
+        // cell is free, try to take it
+        if(diff==0)
+        {
+            if(mTail.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                break;
+        }
+        // queue is full
+        else if(diff<0)
+            return(false);
+        // another producer took it
+        else
+            pos=mTail.load(std::memory_order_relaxed);
+    }
+    // publish data
+    cell->data=item;
+    cell->seq.store(pos+1,std::memory_order_release);
+    // wake consumers
+    wake();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// enqueue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::push(const T &item)
+{
+    while(!tryPush(item))
+    {
+        if(mShutdown.load() || !mCells)
+            return(false);
+        wait(false,std::chrono::steady_clock::time_point::max());
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// try dequeue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::tryPop(T &item)
+{
+    Cell  *cell;
+    size_t pos=mHead.load(std::memory_order_relaxed);
+    // checks
+    if(!mCells)
+        return(false);
+    // find filled cell
+    for(;;)
+    {
+        cell=&mCells[pos&mMask];
+        size_t   seq =cell->seq.load(std::memory_order_acquire);
+        intptr_t diff=(intptr_t)seq-(intptr_t)(pos+1);
+        // cell has data, try to take it
+        if(diff==0)
+        {
+            if(mHead.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                break;
+        }
+        // queue is empty
+        else if(diff<0)
+            return(false);
+        // another consumer took it
+        else
+            pos=mHead.load(std::memory_order_relaxed);
+    }
+    // release cell
+    item=cell->data;
+    cell->seq.store(pos+mMask+1,std::memory_order_release);
+    // wake producers
+    wake();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// dequeue
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::pop(T &item,UINT timeout)
+{
+    std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::time_point::max();
+    // calculate deadline
+    if(timeout!=INFINITE)
+        deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(timeout);
+    // wait for data
+    while(!tryPop(item))
+    {
+        if(mShutdown.load() || std::chrono::steady_clock::now()>=deadline)
+            return(false);
+        wait(true,deadline);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// approximate size
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t RingQueue<T>::size() const
+{
+    size_t head=mHead.load(std::memory_order_relaxed);
+    size_t tail=mTail.load(std::memory_order_relaxed);
+    return(tail>head ? tail-head : 0);
+}
+//////////////////////////////////////////////////////////////////////////
+// wait step
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void RingQueue<T>::wait(bool pop,std::chrono::steady_clock::time_point deadline)
+{
+    switch(mPolicy)
+    {
+        case WAIT_SPIN:
+            break;
+        case WAIT_YIELD:
+            std::this_thread::yield();
+            break;
+        default:
+        {
+            // sleep until woken up, short timeout covers missed notifications
+            std::unique_lock<std::mutex> lock(mWaitSync);
+            std::chrono::steady_clock::time_point limit=std::chrono::steady_clock::now()+std::chrono::milliseconds(10);
+            // register then check again, fence pairs with the one in wake
+            mWaiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(!ready(pop))
+                mWaitCond.wait_until(lock,deadline<limit ? deadline : limit);
+            mWaiters.fetch_sub(1);
+            break;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// wake sleeping threads
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void RingQueue<T>::wake()
+{
+    // checks
+    if(mPolicy!=WAIT_BLOCK)
+        return;
+    // published cell is seen by waiter checking after its registration,
+    // or its registration is seen here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // nobody sleeps, keep hot path lock-free
+    if(mWaiters.load(std::memory_order_relaxed)==0)
+        return;
+    std::lock_guard<std::mutex> lock(mWaitSync);
+    mWaitCond.notify_all();
+}
+//////////////////////////////////////////////////////////////////////////
+// next cell is ready for pop or push
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+bool RingQueue<T>::ready(bool pop) const
+{
+    // checks
+    if(!mCells)
+        return(true);
+    size_t pos=pop ? mHead.load(std::memory_order_relaxed) : mTail.load(std::memory_order_relaxed);
+    size_t seq=mCells[pos&mMask].seq.load(std::memory_order_acquire);
+    return(seq==(pop ? pos+1 : pos));
+}
@@ -0,0 +1,260 @@
+//////////////////////////////////////////////////////////////////////////
+// SQLiteSession.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "SQLiteSession.h"
+#include "AsyncLogger.h"
+
+//////////////////////////////////////////////////////////////////////////
+// table names
+//////////////////////////////////////////////////////////////////////////
+static const char *sqliteTables[]={ "quotes","trades","users","symbols","groups","symbol_groups","margins" };
+//////////////////////////////////////////////////////////////////////////
+// row keys, servers share logins, orders and names so sid is part of key
+//////////////////////////////////////////////////////////////////////////
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransQuote *trans)       { sqlite3_bind_text(stmt,2,trans->data.symbol,-1,SQLITE_STATIC); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransTrade *trans)       { sqlite3_bind_int64(stmt,2,trans->data.order); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransUser *trans)        { sqlite3_bind_int64(stmt,2,trans->data.login); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransSymbol *trans)      { sqlite3_bind_text(stmt,2,trans->data.symbol,-1,SQLITE_STATIC); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransGroup *trans)       { sqlite3_bind_text(stmt,2,trans->data.group,-1,SQLITE_STATIC); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransSymbolGroup *trans) { sqlite3_bind_text(stmt,2,trans->data.name,-1,SQLITE_STATIC); }
+static void sqliteBindKey(sqlite3_stmt *stmt,const TransMargin *trans)      { sqlite3_bind_int64(stmt,2,trans->data.login); }
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+SQLiteSession::SQLiteSession(const std::string &srvc,int index)
+    : DatabaseSession(srvc,index),
+      mDB(nullptr)
+{
+    memset(mStmt,0,sizeof(mStmt));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+SQLiteSession::~SQLiteSession()
+{
+    // lock
+    mSync.lock();
+    // close database
+    disconnect();
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// open database file
+//////////////////////////////////////////////////////////////////////////
+bool SQLiteSession::connect(const std::string &conn)
+{
+    char sql[256];
+    // lock
+    mSync.lock();
+    // disconnect first
+    disconnect();
+    // open file
+    if(sqlite3_open_v2(conn.c_str(),&mDB,SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_NOMUTEX,nullptr)!=SQLITE_OK)
+    {
+        Logger::get().log("'%s': failed to open sqlite database '%s' [%s]",mSrvc.c_str(),conn.c_str(),mDB ? sqlite3_errmsg(mDB) : "");
+        disconnect();
+        mSync.unlock();
+        return(false);
+    }
+    // local replica, trade durability for latency
+    exec("PRAGMA journal_mode=WAL");
+    exec("PRAGMA synchronous=NORMAL");
+    // replica of older schema is dropped, sync loader fills it again
+    if(!upgrade())
+    {
+        disconnect();
+        mSync.unlock();
+        return(false);
+    }
+    // create tables and prepare upserts
+    for(UINT i=0;i<TABLE_COUNT;i++)
+    {
+        _snprintf_s(sql,_countof(sql),_TRUNCATE,"CREATE TABLE IF NOT EXISTS %s(sid INTEGER NOT NULL,key NOT NULL,data BLOB NOT NULL,PRIMARY KEY(sid,key))",sqliteTables[i]);
+        if(!exec(sql))
+        {
+            disconnect();
+            mSync.unlock();
+            return(false);
+        }
+        _snprintf_s(sql,_countof(sql),_TRUNCATE,"INSERT OR REPLACE INTO %s(sid,key,data) VALUES(?,?,?)",sqliteTables[i]);
+        if(sqlite3_prepare_v2(mDB,sql,-1,&mStmt[i],nullptr)!=SQLITE_OK)
+        {
+            Logger::get().log("'%s': failed to prepare sqlite statement [%s]",mSrvc.c_str(),sqlite3_errmsg(mDB));
+            disconnect();
+            mSync.unlock();
+            return(false);
+        }
+    }
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// embedded database is available while open
+//////////////////////////////////////////////////////////////////////////
+bool SQLiteSession::connected()
+{
+    bool res;
+    // lock
+    mSync.lock();
+    res=(mDB!=nullptr);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// upsert rows
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+size_t SQLiteSession::commitRows(UINT table,const T *trans,const int *sids,size_t count,bool *results)
+{
+    size_t committed=0;
+    // checks
+    if(trans==nullptr || count==0 || table>=TABLE_COUNT)
+        return(0);
+    // reset results
+    if(results)
+        for(size_t i=0;i<count;i++)
+            results[i]=false;
+    // lock
+    mSync.lock();
+    // check
+    sqlite3_stmt *stmt=mStmt[table];
+    if(stmt==nullptr || !exec("BEGIN"))
+    {
+        mSync.unlock();
+        return(0);
+    }
+    // upsert rows, failed row does not drop the batch
+    for(size_t i=0;i<count;i++)
+    {
+        sqlite3_bind_int(stmt,1,sids ? sids[i] : 0);
+        sqliteBindKey(stmt,&trans[i]);
+        sqlite3_bind_blob(stmt,3,&trans[i].data,sizeof(trans[i].data),SQLITE_STATIC);
+        int res=sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if(res!=SQLITE_DONE)
+        {
+            Logger::get().log("'%s': failed to commit %s row %u of %u [%s]",mSrvc.c_str(),sqliteTables[table],(unsigned)i+1,(unsigned)count,sqlite3_errmsg(mDB));
+            continue;
+        }
+        // row done
+        if(results)
+            results[i]=true;
+        committed++;
+    }
+    sqlite3_clear_bindings(stmt);
+    // commit transaction
+    if(!exec("COMMIT"))
+    {
+        exec("ROLLBACK");
+        if(results)
+            for(size_t i=0;i<count;i++)
+                results[i]=false;
+        mSync.unlock();
+        return(0);
+    }
+    // unlock
+    mSync.unlock();
+    // log info
+    if(count>1)
+        AsyncLogger::get().log("'%s': committed %u of %u %s rows",mSrvc.c_str(),(unsigned)committed,(unsigned)count,sqliteTables[table]);
+    // result
+    return(committed);
+}
+//////////////////////////////////////////////////////////////////////////
+// commits
+//////////////////////////////////////////////////////////////////////////
+bool SQLiteSession::commitQuote(const TransQuote *trans,int sid)             { return(commitRows(TABLE_QUOTE,      trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitTrade(const TransTrade *trans,int sid)             { return(commitRows(TABLE_TRADE,      trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitUser(const TransUser *trans,int sid)               { return(commitRows(TABLE_USER,       trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitSymbol(const TransSymbol *trans,int sid)           { return(commitRows(TABLE_SYMBOL,     trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitGroup(const TransGroup *trans,int sid)             { return(commitRows(TABLE_GROUP,      trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitSymbolGroup(const TransSymbolGroup *trans,int sid) { return(commitRows(TABLE_SYMBOLGROUP,trans,&sid,1,nullptr)==1); }
+bool SQLiteSession::commitMargin(const TransMargin *trans,int sid)           { return(commitRows(TABLE_MARGIN,     trans,&sid,1,nullptr)==1); }
+//////////////////////////////////////////////////////////////////////////
+// batch commits
+//////////////////////////////////////////////////////////////////////////
+size_t SQLiteSession::commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results)             { return(commitRows(TABLE_QUOTE,      trans,sids,count,results)); }
+size_t SQLiteSession::commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results)             { return(commitRows(TABLE_TRADE,      trans,sids,count,results)); }
+size_t SQLiteSession::commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results)               { return(commitRows(TABLE_USER,       trans,sids,count,results)); }
+size_t SQLiteSession::commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results)           { return(commitRows(TABLE_SYMBOL,     trans,sids,count,results)); }
+size_t SQLiteSession::commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results)             { return(commitRows(TABLE_GROUP,      trans,sids,count,results)); }
+size_t SQLiteSession::commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results) { return(commitRows(TABLE_SYMBOLGROUP,trans,sids,count,results)); }
+size_t SQLiteSession::commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results)           { return(commitRows(TABLE_MARGIN,     trans,sids,count,results)); }
+//////////////////////////////////////////////////////////////////////////
+// drop tables of older schema, version is kept in database header
+//////////////////////////////////////////////////////////////////////////
+bool SQLiteSession::upgrade()
+{
+    sqlite3_stmt *stmt=nullptr;
+    int           version=0;
+    char          sql[128];
+    // read version
+    if(sqlite3_prepare_v2(mDB,"PRAGMA user_version",-1,&stmt,nullptr)!=SQLITE_OK)
+    {
+        Logger::get().log("'%s': failed to read sqlite schema version [%s]",mSrvc.c_str(),sqlite3_errmsg(mDB));
+        return(false);
+    }
+    if(sqlite3_step(stmt)==SQLITE_ROW)
+        version=sqlite3_column_int(stmt,0);
+    sqlite3_finalize(stmt);
+    // up to date
+    if(version==SCHEMA_VERSION)
+        return(true);
+    // drop tables and stamp version
+    for(UINT i=0;i<TABLE_COUNT;i++)
+    {
+        _snprintf_s(sql,_countof(sql),_TRUNCATE,"DROP TABLE IF EXISTS %s",sqliteTables[i]);
+        if(!exec(sql))
+            return(false);
+    }
+    _snprintf_s(sql,_countof(sql),_TRUNCATE,"PRAGMA user_version=%d",SCHEMA_VERSION);
+    if(!exec(sql))
+        return(false);
+    Logger::get().log("'%s': sqlite schema upgraded from version %d to %d",mSrvc.c_str(),version,SCHEMA_VERSION);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// execute statement
+//////////////////////////////////////////////////////////////////////////
+bool SQLiteSession::exec(const char *sql)
+{
+    char *error=nullptr;
+    // checks
+    if(mDB==nullptr)
+        return(false);
+    // execute
+    if(sqlite3_exec(mDB,sql,nullptr,nullptr,&error)!=SQLITE_OK)
+    {
+        Logger::get().log("'%s': sqlite '%s' failed [%s]",mSrvc.c_str(),sql,error ? error : "");
+        sqlite3_free(error);
+        return(false);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// close database
+//////////////////////////////////////////////////////////////////////////
+void SQLiteSession::disconnect()
+{
+    // finalize statements
+    for(UINT i=0;i<TABLE_COUNT;i++)
+        if(mStmt[i])
+        {
+            sqlite3_finalize(mStmt[i]);
+            mStmt[i]=nullptr;
+        }
+    // close database
+    if(mDB)
+    {
+        sqlite3_close(mDB);
+        mDB=nullptr;
+    }
+}
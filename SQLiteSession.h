@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////
+// SQLiteSession.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "DatabaseSession.h"
+#include <sqlite3.h>
+
+//////////////////////////////////////////////////////////////////////////
+// embedded SQLite replica, latest row per server and key stored as
+// binary record of transaction data
+//////////////////////////////////////////////////////////////////////////
+class SQLiteSession : public DatabaseSession
+{
+private:
+    // tables
+    enum EnTable
+    {
+        TABLE_QUOTE      =0,
+        TABLE_TRADE      =1,
+        TABLE_USER       =2,
+        TABLE_SYMBOL     =3,
+        TABLE_GROUP      =4,
+        TABLE_SYMBOLGROUP=5,
+        TABLE_MARGIN     =6,
+        TABLE_COUNT      =7
+    };
+    // constants
+    enum constants
+    {
+        SCHEMA_VERSION=2                // tables keyed by sid and key, rows are transaction data
+    };
+
+private:
+    // transactions lock
+    std::mutex          mSync;
+    // database and prepared upserts
+    sqlite3            *mDB;
+    sqlite3_stmt       *mStmt[TABLE_COUNT];
+
+public:
+    // ctor/dtor
+    SQLiteSession(const std::string &srvc,int index);
+    virtual ~SQLiteSession();
+    // connect, conn is database file path
+    virtual bool    connect(const std::string &conn);
+    virtual bool    connected();
+    // commit transactions
+    virtual bool    commitQuote(const TransQuote *trans,int sid);
+    virtual bool    commitTrade(const TransTrade *trans,int sid);
+    virtual bool    commitUser(const TransUser *trans,int sid);
+    virtual bool    commitSymbol(const TransSymbol *trans,int sid);
+    virtual bool    commitGroup(const TransGroup *trans,int sid);
+    virtual bool    commitSymbolGroup(const TransSymbolGroup *trans,int sid);
+    virtual bool    commitMargin(const TransMargin *trans,int sid);
+    // batch commit transactions, one SQL transaction per batch, returns number of committed rows
+    virtual size_t  commitQuotes(const TransQuote *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitTrades(const TransTrade *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitUsers(const TransUser *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbols(const TransSymbol *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitGroups(const TransGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitSymbolGroups(const TransSymbolGroup *trans,const int *sids,size_t count,bool *results);
+    virtual size_t  commitMargins(const TransMargin *trans,const int *sids,size_t count,bool *results);
+
+private:
+    // upsert rows in one transaction
+    template<class T>
+    size_t          commitRows(UINT table,const T *trans,const int *sids,size_t count,bool *results);
+    // drop tables of older schema
+    bool            upgrade();
+    // execute statement
+    bool            exec(const char *sql);
+    // disconnect
+    void            disconnect();
+};
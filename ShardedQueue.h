@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+// ShardedQueue.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "RingQueue.h"
+
+//////////////////////////////////////////////////////////////////////////
+// set of queues, items with equal key always go to the same shard
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+class ShardedQueue
+{
+public:
+    // shard metrics
+    struct Stats
+    {
+        UINT64      pushed;         // items pushed
+        UINT64      depth;          // current depth
+        UINT64      highwater;      // max depth
+    };
+
+private:
+    // shard
+    struct Shard
+    {
+        RingQueue<T>        queue;
+        std::atomic<UINT64> pushed;
+        std::atomic<UINT64> highwater;
+        Shard() : pushed(0),highwater(0) {}
+    };
+    // shards
+    std::vector<std::unique_ptr<Shard>> mShards;
+
+public:
+    // ctor/dtor
+    ShardedQueue() {}
+    ~ShardedQueue() {}
+    // init shards with capacity and wait policy of each one
+    bool init(size_t shards,size_t capacity,int policy)
+    {
+        // checks
+        if(shards==0 || !mShards.empty())
+            return(false);
+        // create shards
+        for(size_t i=0;i<shards;i++)
+        {
+            mShards.push_back(std::unique_ptr<Shard>(new Shard()));
+            if(!mShards.back()->queue.init(capacity,policy))
+                return(false);
+        }
+        // success
+        return(true);
+    }
+    // release waiting consumers
+    void shutdown()
+    {
+        for(auto &it : mShards)
+            it->queue.shutdown();
+    }
+    // shard of key
+    size_t shard(size_t key) const { return(key%mShards.size()); }
+    size_t shards() const          { return(mShards.size()); }
+    // enqueue by key
+    bool push(size_t key,const T &item)
+    {
+        // checks
+        if(mShards.empty())
+            return(false);
+        Shard *sh=mShards[shard(key)].get();
+        // enqueue
+        if(!sh->queue.push(item))
+            return(false);
+        // metrics
+        sh->pushed.fetch_add(1,std::memory_order_relaxed);
+        UINT64 depth=sh->queue.size();
+        UINT64 high =sh->highwater.load(std::memory_order_relaxed);
+        while(depth>high && !sh->highwater.compare_exchange_weak(high,depth,std::memory_order_relaxed))
+            ;
+        // success
+        return(true);
+    }
+    // enqueue by key without waiting, fails if shard is full
+    bool tryPush(size_t key,const T &item)
+    {
+        // checks
+        if(mShards.empty())
+            return(false);
+        Shard *sh=mShards[shard(key)].get();
+        // enqueue
+        if(!sh->queue.tryPush(item))
+            return(false);
+        sh->pushed.fetch_add(1,std::memory_order_relaxed);
+        return(true);
+    }
+    // dequeue from shard, one consumer per shard keeps key order
+    bool pop(size_t shard,T &item,UINT timeout=INFINITE)
+    {
+        // checks
+        if(shard>=mShards.size())
+            return(false);
+        return(mShards[shard]->queue.pop(item,timeout));
+    }
+    // metrics
+    Stats stats(size_t shard) const
+    {
+        Stats res={0};
+        // checks
+        if(shard>=mShards.size())
+            return(res);
+        res.pushed   =mShards[shard]->pushed.load(std::memory_order_relaxed);
+        res.depth    =mShards[shard]->queue.size();
+        res.highwater=mShards[shard]->highwater.load(std::memory_order_relaxed);
+        return(res);
+    }
+    size_t depth() const
+    {
+        size_t res=0;
+        for(auto &it : mShards)
+            res+=it->queue.size();
+        return(res);
+    }
+};
@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+// SharedTrans.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "TransAllocator.h"
+#include "TransKey.h"
+
+//////////////////////////////////////////////////////////////////////////
+// reference-counted transaction shared by several database targets
+//////////////////////////////////////////////////////////////////////////
+class SharedTrans
+{
+public:
+    // payload types
+    enum EnType
+    {
+        TYPE_QUOTE      =0,
+        TYPE_TRADE      =1,
+        TYPE_USER       =2,
+        TYPE_SYMBOL     =3,
+        TYPE_GROUP      =4,
+        TYPE_SYMBOLGROUP=5,
+        TYPE_MARGIN     =6,
+        TYPE_COUNT      =7
+    };
+
+private:
+    // payload owned by TransAllocator
+    void           *mData;
+    UINT            mType;
+    int             mSid;
+    size_t          mKey;
+    void          (*mFree)(void*);
+    // readers left
+    std::atomic<int> mRefs;
+    // enqueue time
+    std::chrono::steady_clock::time_point mTime;
+
+public:
+    // wrap pooled transaction, payload goes back to pool with last reference
+    template<class T>
+    static SharedTrans *wrap(T *trans,int sid=0)
+    {
+        // checks
+        if(trans==nullptr)
+            return(nullptr);
+        SharedTrans *res=new SharedTrans();
+        res->mData=trans;
+        res->mType=type(trans);
+        res->mSid =sid;
+        res->mKey =TransKey::key(sid,trans);
+        res->mFree=[](void *data) { TransAllocator::get().release(static_cast<T*>(data)); };
+        res->mTime=std::chrono::steady_clock::now();
+        return(res);
+    }
+    // references
+    void            addRef()        { mRefs.fetch_add(1,std::memory_order_relaxed); }
+    void            release()
+    {
+        if(mRefs.fetch_sub(1,std::memory_order_acq_rel)!=1)
+            return;
+        // last reader frees payload
+        if(mFree && mData)
+            mFree(mData);
+        delete this;
+    }
+    // payload
+    UINT            type() const    { return(mType); }
+    int             sid() const     { return(mSid);  }
+    size_t          key() const     { return(mKey);  }
+    template<class T>
+    const T        *data() const    { return(static_cast<const T*>(mData)); }
+    // microseconds since wrap
+    INT64           age() const     { return(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-mTime).count()); }
+
+private:
+    // ctor/dtor, created by wrap with one reference held by the producer
+    SharedTrans() : mData(nullptr),mType(0),mSid(0),mKey(0),mFree(nullptr),mRefs(1) {}
+    ~SharedTrans() {}
+    // type of payload
+    static UINT     type(const TransQuote*)       { return(TYPE_QUOTE);       }
+    static UINT     type(const TransTrade*)       { return(TYPE_TRADE);       }
+    static UINT     type(const TransUser*)        { return(TYPE_USER);        }
+    static UINT     type(const TransSymbol*)      { return(TYPE_SYMBOL);      }
+    static UINT     type(const TransGroup*)       { return(TYPE_GROUP);       }
+    static UINT     type(const TransSymbolGroup*) { return(TYPE_SYMBOLGROUP); }
+    static UINT     type(const TransMargin*)      { return(TYPE_MARGIN);      }
+};
@@ -0,0 +1,312 @@
+//////////////////////////////////////////////////////////////////////////
+// Spool.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Spool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+Spool::Spool()
+    : mFlushInterval(0),
+      mFlushOffset(0),
+      mFlushTime(std::chrono::steady_clock::now()),
+      mFlusher(nullptr),
+      mStop(false),
+      mReplaying(false)
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+Spool::~Spool()
+{
+    shutdown();
+}
+//////////////////////////////////////////////////////////////////////////
+// open or recover spool file
+//////////////////////////////////////////////////////////////////////////
+bool Spool::init(const std::string &path,UINT flush)
+{
+    // lock
+    mSync.lock();
+    // open file
+    if(!mFile.open(path,SPOOL_GROW))
+    {
+        mSync.unlock();
+        return(false);
+    }
+    mFlushInterval=flush;
+    // new or broken file, start from scratch
+    Header *hdr=header();
+    if(hdr->magic!=SPOOL_MAGIC || hdr->version!=SPOOL_VERSION ||
+       hdr->head<sizeof(Header) || hdr->tail<hdr->head || hdr->tail>mFile.size() || hdr->first>hdr->seq+1)
+    {
+        if(hdr->magic!=0)
+            Logger::get().log("'%s': invalid spool file header, spool reset",path.c_str());
+        memset(hdr,0,sizeof(Header));
+        hdr->magic  =SPOOL_MAGIC;
+        hdr->version=SPOOL_VERSION;
+        hdr->head   =sizeof(Header);
+        hdr->tail   =sizeof(Header);
+        hdr->first  =1;
+        mFile.flush(0,sizeof(Header));
+    }
+    mFlushOffset=hdr->tail;
+    // log info
+    if(hdr->tail>hdr->head)
+        Logger::get().log("'%s': recovered %I64u bytes of spooled transactions",path.c_str(),hdr->tail-hdr->head);
+    // unlock
+    mSync.unlock();
+    // flush timer
+    if(flush>0 && mFlusher==nullptr)
+    {
+        mStop.store(false);
+        mFlusher=new std::thread(&Spool::funcWrapFlush,this);
+    }
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// shutdown
+//////////////////////////////////////////////////////////////////////////
+void Spool::shutdown()
+{
+    // stop flush timer
+    if(mFlusher)
+    {
+        mSync.lock();
+        mStop.store(true);
+        mStopCond.notify_all();
+        mSync.unlock();
+        mFlusher->join();
+        delete(mFlusher);
+        mFlusher=nullptr;
+    }
+    // lock
+    mSync.lock();
+    // flush and close
+    if(mFile.opened())
+    {
+        flushDue(true);
+        mFile.close();
+    }
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// append record if spool is not empty
+//////////////////////////////////////////////////////////////////////////
+bool Spool::appendIfActive(UINT type,const void *data,UINT size)
+{
+    bool res=false;
+    // lock
+    mSync.lock();
+    // spool has records, keep order
+    if(mFile.opened() && header()->tail>header()->head)
+        res=appendRecord(type,data,size);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// append record
+//////////////////////////////////////////////////////////////////////////
+bool Spool::append(UINT type,const void *data,UINT size)
+{
+    bool res=false;
+    // lock
+    mSync.lock();
+    // append
+    if(mFile.opened())
+        res=appendRecord(type,data,size);
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// append record under lock
+//////////////////////////////////////////////////////////////////////////
+bool Spool::appendRecord(UINT type,const void *data,UINT size)
+{
+    // checks
+    if(data==nullptr || size==0)
+        return(false);
+    // grow file if needed
+    UINT64 need=header()->tail+recordSize(size);
+    if(need>mFile.size())
+    {
+        // flush pending records before remap
+        flushDue(true);
+        if(!mFile.resize(need+SPOOL_GROW))
+            return(false);
+    }
+    Header *hdr=header();
+    // write record, payload first and tail last
+    Record *rec=reinterpret_cast<Record*>(mFile.data()+hdr->tail);
+    rec->type    =type;
+    rec->size    =size;
+    rec->reserved=0;
+    rec->seq     =hdr->seq+1;
+    memcpy(rec+1,data,size);
+    memset(reinterpret_cast<char*>(rec+1)+size,0,(size_t)(recordSize(size)-sizeof(Record)-size));
+    rec->magic   =RECORD_MAGIC;
+    hdr->seq++;
+    hdr->tail+=recordSize(size);
+    // group flush
+    flushDue(false);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// replay records, record is committed outside of lock so appends go on
+//////////////////////////////////////////////////////////////////////////
+size_t Spool::replay(ReplayFunc func)
+{
+    std::vector<char> payload;
+    size_t count=0;
+    // lock
+    mSync.lock();
+    // checks, single replay at a time
+    if(!mFile.opened() || mReplaying)
+    {
+        mSync.unlock();
+        return(0);
+    }
+    mReplaying=true;
+    // walk records in order
+    while(header()->head<header()->tail)
+    {
+        Header *hdr=header();
+        Record *rec=reinterpret_cast<Record*>(mFile.data()+hdr->head);
+        // torn, broken or stale record of previous drain cycle, drop the rest
+        if(hdr->head+sizeof(Record)>hdr->tail || rec->magic!=RECORD_MAGIC ||
+           hdr->head+recordSize(rec->size)>hdr->tail || rec->seq!=hdr->first)
+        {
+            Logger::get().log("'%s': broken spool record at %I64u, %I64u bytes dropped",mFile.path().c_str(),hdr->head,hdr->tail-hdr->head);
+            hdr->head =hdr->tail;
+            hdr->first=hdr->seq+1;
+            break;
+        }
+        // copy record, view may be remapped by appends while unlocked
+        UINT type=rec->type;
+        UINT size=rec->size;
+        payload.assign(reinterpret_cast<char*>(rec+1),reinterpret_cast<char*>(rec+1)+size);
+        // unlock
+        mSync.unlock();
+        // commit record
+        bool res=func(type,payload.data(),size);
+        // lock
+        mSync.lock();
+        // closed meanwhile or kept
+        if(!mFile.opened() || !res)
+            break;
+        // acknowledge
+        header()->head+=recordSize(size);
+        header()->first++;
+        count++;
+    }
+    mReplaying=false;
+    // checks
+    if(!mFile.opened())
+    {
+        mSync.unlock();
+        return(count);
+    }
+    // truncate drained spool
+    Header *hdr=header();
+    if(hdr->head==hdr->tail)
+    {
+        hdr->head   =sizeof(Header);
+        hdr->tail   =sizeof(Header);
+        hdr->first  =hdr->seq+1;
+        mFlushOffset=hdr->tail;
+    }
+    flushDue(true);
+    // unlock
+    mSync.unlock();
+    // log info
+    if(count)
+        Logger::get().log("'%s': replayed %u spooled transactions",mFile.path().c_str(),(unsigned)count);
+    // result
+    return(count);
+}
+//////////////////////////////////////////////////////////////////////////
+// spool has records
+//////////////////////////////////////////////////////////////////////////
+bool Spool::active()
+{
+    return(pending()>0);
+}
+//////////////////////////////////////////////////////////////////////////
+// pending bytes
+//////////////////////////////////////////////////////////////////////////
+UINT64 Spool::pending()
+{
+    UINT64 res=0;
+    // lock
+    mSync.lock();
+    if(mFile.opened())
+        res=header()->tail-header()->head;
+    // unlock
+    mSync.unlock();
+    // result
+    return(res);
+}
+//////////////////////////////////////////////////////////////////////////
+// force flush
+//////////////////////////////////////////////////////////////////////////
+void Spool::flush()
+{
+    // lock
+    mSync.lock();
+    if(mFile.opened())
+        flushDue(true);
+    // unlock
+    mSync.unlock();
+}
+//////////////////////////////////////////////////////////////////////////
+// group flush of records appended since last flush
+//////////////////////////////////////////////////////////////////////////
+void Spool::flushDue(bool force)
+{
+    std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+    Header *hdr=header();
+    // check interval
+    if(!force && mFlushInterval>0 && now-mFlushTime<std::chrono::milliseconds(mFlushInterval))
+        return;
+    // nothing appended
+    if(!force && hdr->tail==mFlushOffset)
+        return;
+    // records first, header last
+    if(hdr->tail>mFlushOffset)
+        mFile.flush(mFlushOffset,hdr->tail-mFlushOffset);
+    mFile.flush(0,sizeof(Header));
+    mFlushOffset=hdr->tail;
+    mFlushTime  =now;
+}
+//////////////////////////////////////////////////////////////////////////
+// flush timer thread
+//////////////////////////////////////////////////////////////////////////
+void Spool::funcWrapFlush(void *param)
+{
+    if(param)
+        static_cast<Spool*>(param)->runFlush();
+}
+//////////////////////////////////////////////////////////////////////////
+// flush records left by the last appends
+//////////////////////////////////////////////////////////////////////////
+void Spool::runFlush()
+{
+    std::unique_lock<std::mutex> lock(mSync);
+    // loop
+    while(!mStop.load())
+    {
+        mStopCond.wait_for(lock,std::chrono::milliseconds(mFlushInterval),[this]() { return(mStop.load()); });
+        if(mFile.opened())
+            flushDue(false);
+    }
+}
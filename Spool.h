@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+// Spool.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "MappedFile.h"
+
+//////////////////////////////////////////////////////////////////////////
+// durable append-only queue of uncommitted transactions
+//////////////////////////////////////////////////////////////////////////
+class Spool
+{
+public:
+    // replay callback, returns false to stop replay and keep the record
+    typedef std::function<bool(UINT type,const void *data,UINT size)> ReplayFunc;
+
+private:
+    // file header
+    struct Header
+    {
+        UINT            magic;
+        UINT            version;
+        UINT64          head;           // offset of first not acknowledged record
+        UINT64          tail;           // end of last record
+        UINT64          seq;            // last record sequence
+        UINT64          first;          // sequence of record at head
+    };
+    // record header, payload follows
+    struct Record
+    {
+        UINT            magic;
+        UINT            type;
+        UINT            size;
+        UINT            reserved;
+        UINT64          seq;
+    };
+    // constants
+    enum constants
+    {
+        SPOOL_MAGIC  =0x4C4F5053,       // 'SPOL'
+        RECORD_MAGIC =0x44524352,       // 'RCRD'
+        SPOOL_VERSION=2,
+        SPOOL_GROW   =16*1024*1024      // grow step
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    // spool file
+    MappedFile      mFile;
+    // group flush
+    UINT            mFlushInterval;
+    UINT64          mFlushOffset;
+    std::chrono::steady_clock::time_point mFlushTime;
+    // flush timer, bounds durability delay once appends stop
+    std::thread    *mFlusher;
+    std::atomic<bool> mStop;
+    std::condition_variable mStopCond;
+    // record is being replayed outside of lock
+    bool            mReplaying;
+
+public:
+    // ctor/dtor
+    Spool();
+    ~Spool();
+    // open or recover spool file, flush interval in ms (0 - flush every record)
+    bool            init(const std::string &path,UINT flush);
+    void            shutdown();
+    // append record if spool is not empty, keeps order with records already spooled
+    bool            appendIfActive(UINT type,const void *data,UINT size);
+    // append record unconditionally
+    bool            append(UINT type,const void *data,UINT size);
+    // replay records in order, acknowledged records are truncated
+    size_t          replay(ReplayFunc func);
+    // state
+    bool            active();
+    UINT64          pending();
+    // force flush to disk
+    void            flush();
+
+private:
+    Header         *header() { return(reinterpret_cast<Header*>(mFile.data())); }
+    static UINT64   recordSize(UINT size) { return(sizeof(Record)+((size+7)&~7u)); }
+    bool            appendRecord(UINT type,const void *data,UINT size);
+    void            flushDue(bool force);
+    // flush timer thread
+    static void     funcWrapFlush(void *param);
+    void            runFlush();
+};
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////
+// SyncLoader.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "SyncLoader.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+SyncLoader::SyncLoader()
+    : mSID(0),
+      mChunk(0),
+      mRows(0),
+      mFailed(0),
+      mStart(std::chrono::steady_clock::now())
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+SyncLoader::~SyncLoader()
+{
+    // never leave targets paused
+    for(auto target : mTargets)
+        target->resume();
+}
+//////////////////////////////////////////////////////////////////////////
+// start snapshot
+//////////////////////////////////////////////////////////////////////////
+void SyncLoader::begin(int sid,const std::vector<DatabaseTarget*> &targets,size_t chunk)
+{
+    // hold live updates until snapshot is loaded
+    for(auto target : targets)
+        target->pause();
+    mTargets  =targets;
+    mSID      =sid;
+    mChunk    =chunk ? chunk : 1;
+    mRows     =0;
+    mFailed   =0;
+    mStart    =std::chrono::steady_clock::now();
+    // reserve chunks
+    mGroups.clear();       mGroups.reserve(mChunk);
+    mSymbols.clear();      mSymbols.reserve(mChunk);
+    mSymbolGroups.clear(); mSymbolGroups.reserve(mChunk);
+    mUsers.clear();        mUsers.reserve(mChunk);
+    mTrades.clear();       mTrades.reserve(mChunk);
+}
+//////////////////////////////////////////////////////////////////////////
+// add rows
+//////////////////////////////////////////////////////////////////////////
+void SyncLoader::add(const TransGroup *trans)       { push(mGroups,      trans,&Database::loadGroups);       }
+void SyncLoader::add(const TransSymbol *trans)      { push(mSymbols,     trans,&Database::loadSymbols);      }
+void SyncLoader::add(const TransSymbolGroup *trans) { push(mSymbolGroups,trans,&Database::loadSymbolGroups); }
+void SyncLoader::add(const TransUser *trans)        { push(mUsers,       trans,&Database::loadUsers);        }
+void SyncLoader::add(const TransTrade *trans)       { push(mTrades,      trans,&Database::loadTrades);       }
+//////////////////////////////////////////////////////////////////////////
+// commit remaining rows
+//////////////////////////////////////////////////////////////////////////
+bool SyncLoader::finish()
+{
+    // config objects first, then accounts and trades
+    flush(mGroups,      &Database::loadGroups);
+    flush(mSymbols,     &Database::loadSymbols);
+    flush(mSymbolGroups,&Database::loadSymbolGroups);
+    flush(mUsers,       &Database::loadUsers);
+    flush(mTrades,      &Database::loadTrades);
+    // apply live updates queued during load
+    for(auto target : mTargets)
+        target->resume();
+    // log totals
+    double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-mStart).count();
+    Logger::get().log("server #%d: bulk sync of %I64u rows to %u databases in %.2f s (%.0f rows/s), %I64u failed",
+                      mSID,mRows,(UINT)mTargets.size(),seconds,seconds>0 ? mRows/seconds : 0.0,mFailed);
+    // result
+    return(mFailed==0);
+}
+//////////////////////////////////////////////////////////////////////////
+// add row and commit full chunk
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void SyncLoader::push(std::vector<T> &rows,const T *trans,size_t (Database::*func)(const T*,const int*,size_t,bool*))
+{
+    // checks
+    if(trans==nullptr)
+        return;
+    // add row
+    rows.push_back(*trans);
+    if(rows.size()>=mChunk)
+        flush(rows,func);
+}
+//////////////////////////////////////////////////////////////////////////
+// commit rows to every database
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+void SyncLoader::flush(std::vector<T> &rows,size_t (Database::*func)(const T*,const int*,size_t,bool*))
+{
+    // checks
+    if(rows.empty())
+        return;
+    std::unique_ptr<bool[]> results(new bool[rows.size()]);
+    std::vector<bool>       failed(rows.size(),false);
+    std::vector<int>        sids(rows.size(),mSID);
+    // one load per chunk and database
+    for(auto target : mTargets)
+    {
+        (target->database()->*func)(rows.data(),sids.data(),rows.size(),results.get());
+        for(size_t i=0;i<rows.size();i++)
+            if(!results[i])
+                failed[i]=true;
+    }
+    // row counts once however many databases it failed on
+    for(size_t i=0;i<rows.size();i++)
+        if(failed[i])
+            mFailed++;
+    mRows+=rows.size();
+    rows.clear();
+}
@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////
+// SyncLoader.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "DatabaseTarget.h"
+
+//////////////////////////////////////////////////////////////////////////
+// bulk load of server snapshot, target workers are paused meanwhile so
+// live updates queued during load are applied after snapshot rows
+//////////////////////////////////////////////////////////////////////////
+class SyncLoader
+{
+private:
+    // target databases
+    std::vector<DatabaseTarget*> mTargets;
+    // server being synchronized
+    int             mSID;
+    // rows per database transaction
+    size_t          mChunk;
+    // pending rows
+    std::vector<TransGroup>       mGroups;
+    std::vector<TransSymbol>      mSymbols;
+    std::vector<TransSymbolGroup> mSymbolGroups;
+    std::vector<TransUser>        mUsers;
+    std::vector<TransTrade>       mTrades;
+    // counters, row failed on any database is counted once
+    UINT64          mRows;
+    UINT64          mFailed;
+    std::chrono::steady_clock::time_point mStart;
+
+public:
+    // ctor/dtor
+    SyncLoader();
+    ~SyncLoader();
+    // start snapshot of server, pauses targets
+    void            begin(int sid,const std::vector<DatabaseTarget*> &targets,size_t chunk);
+    // add snapshot rows, full chunks are committed immediately
+    void            add(const TransGroup *trans);
+    void            add(const TransSymbol *trans);
+    void            add(const TransSymbolGroup *trans);
+    void            add(const TransUser *trans);
+    void            add(const TransTrade *trans);
+    // commit remaining rows, resume targets and log totals, returns false if any row failed
+    bool            finish();
+
+private:
+    // add row and commit full chunk
+    template<class T>
+    void            push(std::vector<T> &rows,const T *trans,size_t (Database::*func)(const T*,const int*,size_t,bool*));
+    // commit rows to every database
+    template<class T>
+    void            flush(std::vector<T> &rows,size_t (Database::*func)(const T*,const int*,size_t,bool*));
+};
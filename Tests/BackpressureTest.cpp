@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////////////////////////
+// BackpressureTest.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+#include "../Backpressure.h"
+
+//////////////////////////////////////////////////////////////////////////
+// queue in front of slow backend, margin level sequence goes in balance
+//////////////////////////////////////////////////////////////////////////
+class BackpressureTestQueue
+{
+private:
+    std::mutex      mSync;
+    std::deque<TransMargin> mItems;
+    size_t          mMax;
+
+public:
+    BackpressureTestQueue() : mMax(0) {}
+    void            push(const TransMargin *trans)
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+        mItems.push_back(*trans);
+        if(mItems.size()>mMax)
+            mMax=mItems.size();
+    }
+    bool            pop(TransMargin &trans)
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+        if(mItems.empty())
+            return(false);
+        trans=mItems.front();
+        mItems.pop_front();
+        return(true);
+    }
+    size_t          size()    { std::lock_guard<std::mutex> lock(mSync); return(mItems.size()); }
+    size_t          maxSize() { std::lock_guard<std::mutex> lock(mSync); return(mMax); }
+};
+//////////////////////////////////////////////////////////////////////////
+// producer outpaces slow backend: queue and coalesce map stay bounded and
+// backend never applies older margin level over newer one of account
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(BackpressureSlowBackend)
+{
+    enum { ACCOUNTS=50,LEVELS=100000,HIGH=200,LOW=50,SID=3 };
+    Backpressure           bp;
+    Backpressure::Settings settings={0};
+    BackpressureTestQueue  queue;
+    std::vector<double>    applied(ACCOUNTS,-1.0);
+    std::atomic<UINT64>    stale(0);
+    std::atomic<UINT64>    wrongSid(0);
+    std::atomic<size_t>    maxPending(0);
+    std::atomic<bool>      stop(false);
+    UINT                   unexpected=0;
+    // margin levels coalesce, the rest passes
+    settings.high=HIGH;
+    settings.low =LOW;
+    settings.policy[Backpressure::CLASS_MARGIN]=Backpressure::POLICY_COALESCE;
+    TEST_CHECK(bp.init(settings,[&queue]() { return(queue.size()); }));
+    // slow backend applies levels and drains coalesced ones below low watermark
+    std::thread backend([&]()
+    {
+        TransMargin trans;
+        for(;;)
+        {
+            if(queue.pop(trans))
+            {
+                int login=trans.data.login;
+                if(trans.data.balance<applied[login])
+                    stale.fetch_add(1);
+                applied[login]=trans.data.balance;
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+                bp.drained();
+            }
+            else
+                if(stop.load() && bp.stats().pending==0)
+                    break;
+            bp.drain([&](int sid,const TransMargin *margin)
+            {
+                if(sid!=SID)
+                    wrongSid.fetch_add(1);
+                queue.push(margin);
+            });
+            if(!queue.size())
+                std::this_thread::yield();
+        }
+    });
+    // producer, balance is sequence number of level
+    TransMargin trans;
+    memset(&trans,0,sizeof(trans));
+    for(UINT i=0;i<LEVELS;i++)
+    {
+        trans.data.login  =i%ACCOUNTS;
+        trans.data.balance=i;
+        switch(bp.admit(SID,&trans))
+        {
+            case Backpressure::ACTION_ENQUEUE:
+                queue.push(&trans);
+                break;
+            case Backpressure::ACTION_COALESCE:
+                bp.coalesce(SID,&trans);
+                break;
+            default:
+                unexpected++;
+                break;
+        }
+        size_t pending=(size_t)bp.stats().pending;
+        if(pending>maxPending.load())
+            maxPending.store(pending);
+    }
+    stop.store(true);
+    backend.join();
+    // shedding happened, memory stayed bounded and newest levels won
+    Backpressure::Stats stats=bp.stats();
+    TEST_CHECK(unexpected==0);
+    TEST_CHECK(stats.episodes>0 && stats.coalesced>0);
+    TEST_CHECK(maxPending.load()<=ACCOUNTS);
+    TEST_CHECK(queue.maxSize()<=HIGH+ACCOUNTS);
+    TEST_CHECK(stale.load()==0 && wrongSid.load()==0);
+    for(UINT i=0;i<ACCOUNTS;i++)
+        TEST_CHECK(applied[i]==(double)(LEVELS-ACCOUNTS+i));
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// level arriving after shedding stopped replaces pending coalesced one
+// instead of overtaking it through the queue
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(BackpressureCoalescePending)
+{
+    Backpressure             bp;
+    Backpressure::Settings   settings={0};
+    size_t                   depth=0;
+    std::vector<TransMargin> handed;
+    TransMargin              trans;
+    settings.high=10;
+    settings.low =5;
+    settings.policy[Backpressure::CLASS_MARGIN]=Backpressure::POLICY_COALESCE;
+    TEST_CHECK(bp.init(settings,[&depth]() { return(depth); }));
+    memset(&trans,0,sizeof(trans));
+    trans.data.login=7;
+    // above high watermark level is coalesced
+    depth=10;
+    trans.data.balance=1;
+    TEST_CHECK(bp.admit(1,&trans)==Backpressure::ACTION_COALESCE);
+    bp.coalesce(1,&trans);
+    // below low watermark account with pending level still coalesces, other account passes
+    depth=0;
+    bp.drained();
+    trans.data.balance=2;
+    TEST_CHECK(bp.admit(1,&trans)==Backpressure::ACTION_COALESCE);
+    bp.coalesce(1,&trans);
+    trans.data.login=8;
+    TEST_CHECK(bp.admit(1,&trans)==Backpressure::ACTION_ENQUEUE);
+    // drain hands over newest level only, account passes afterwards
+    TEST_CHECK(bp.drain([&handed](int sid,const TransMargin *margin) { handed.push_back(*margin); })==1);
+    TEST_CHECK(handed.size()==1 && handed[0].data.login==7 && handed[0].data.balance==2);
+    trans.data.login=7;
+    TEST_CHECK(bp.admit(1,&trans)==Backpressure::ACTION_ENQUEUE);
+    return(true);
+}
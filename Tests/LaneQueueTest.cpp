@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////
+// LaneQueueTest.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+#include "../LaneQueue.h"
+
+//////////////////////////////////////////////////////////////////////////
+// test items, configuration item carries its version, dependent item the
+// version of configuration pushed before it
+//////////////////////////////////////////////////////////////////////////
+typedef LaneQueue<UINT64> LaneTestQueue;
+static const UINT64 LANE_TEST_CONFIG=1ULL<<63;
+static const UINT   laneTestWeights[LaneTestQueue::LANE_COUNT]={ 4,1,1 };
+//////////////////////////////////////////////////////////////////////////
+// dependent item waits until configuration item pushed before it is done
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(LaneQueueDependsBefore)
+{
+    LaneTestQueue queue;
+    UINT64        item;
+    TEST_CHECK(queue.init("test_depends",2,16,laneTestWeights));
+    // key 1 goes to shard 1, configuration always to shard 0
+    TEST_CHECK(queue.push(1,LaneTestQueue::LANE_ACCOUNT,10));
+    TEST_CHECK(queue.push(1,LaneTestQueue::LANE_CONFIG,LANE_TEST_CONFIG|1));
+    TEST_CHECK(queue.push(1,LaneTestQueue::LANE_ACCOUNT,11));
+    TEST_CHECK(queue.push(1,LaneTestQueue::LANE_QUOTE,12));
+    // item pushed before configuration is not held
+    TEST_CHECK(queue.tryPop(1,item) && item==10);
+    TEST_CHECK(!queue.tryPop(1,item));
+    // configuration item handed out but not done yet
+    TEST_CHECK(queue.tryPop(0,item) && item==(LANE_TEST_CONFIG|1));
+    TEST_CHECK(!queue.tryPop(1,item));
+    // shard 0 consumer is back, dependents are released in lane order
+    TEST_CHECK(!queue.tryPop(0,item));
+    TEST_CHECK(queue.pop(1,item,100));
+    UINT64 other;
+    TEST_CHECK(queue.pop(1,other,100));
+    TEST_CHECK((item==11 && other==12) || (item==12 && other==11));
+    TEST_CHECK(!queue.tryPop(1,item) && queue.size()==0);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// consumers never see item before configuration it was pushed after
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(LaneQueueDependsBeforeThreads)
+{
+    enum { SHARDS=4,ITEMS=200000,CONFIG_EVERY=97 };
+    LaneTestQueue             queue;
+    std::atomic<UINT64>       applied(0);
+    std::atomic<UINT64>       consumed(0);
+    std::atomic<UINT64>       violations(0);
+    std::atomic<bool>         stop(false);
+    std::vector<std::thread*> consumers;
+    UINT64                    pushed=0,version=0;
+    TEST_CHECK(queue.init("test_depends_threads",SHARDS,64,laneTestWeights));
+    // one consumer per shard, shard 0 applies configuration
+    for(size_t i=0;i<SHARDS;i++)
+        consumers.push_back(new std::thread([&queue,&applied,&consumed,&violations,&stop,i]()
+        {
+            UINT64 item;
+            while(!stop.load())
+            {
+                if(!queue.pop(i,item,10))
+                    continue;
+                if(item&LANE_TEST_CONFIG)
+                    applied.store(item&~LANE_TEST_CONFIG);
+                else
+                    if(applied.load()<item)
+                        violations.fetch_add(1);
+                consumed.fetch_add(1);
+            }
+        }));
+    // producer interleaves configuration and account or quote items
+    for(UINT64 i=0;i<ITEMS;i++,pushed++)
+        if(i%CONFIG_EVERY==0)
+            TEST_CHECK(queue.push((size_t)i,LaneTestQueue::LANE_CONFIG,LANE_TEST_CONFIG|++version));
+        else
+            TEST_CHECK(queue.push((size_t)i,i%2 ? LaneTestQueue::LANE_ACCOUNT : LaneTestQueue::LANE_QUOTE,version));
+    // wait for consumers
+    for(int i=0;i<10000 && consumed.load()<pushed;i++)
+        Sleep(1);
+    stop.store(true);
+    queue.shutdown();
+    for(auto it : consumers)
+    {
+        it->join();
+        delete it;
+    }
+    TEST_CHECK(consumed.load()==pushed);
+    TEST_CHECK(violations.load()==0);
+    TEST_CHECK(applied.load()==version);
+    return(true);
+}
@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////
+// QueueOrderTest.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+#include "../ShardedQueue.h"
+#include "../LaneQueue.h"
+
+//////////////////////////////////////////////////////////////////////////
+// test sizes, every key (ticket or login) is owned by one producer that
+// pushes its sequence numbers in order
+//////////////////////////////////////////////////////////////////////////
+enum EnQueueOrderTest
+{
+    ORDER_PRODUCERS=4,
+    ORDER_SHARDS   =4,
+    ORDER_KEYS     =64,
+    ORDER_PER_KEY  =5000,
+    ORDER_CAPACITY =32              // small shards make producers wait
+};
+//////////////////////////////////////////////////////////////////////////
+// item of key and sequence
+//////////////////////////////////////////////////////////////////////////
+static UINT64 orderItem(UINT key,UINT seq) { return(((UINT64)key<<32)|seq); }
+static UINT   orderKey(UINT64 item)        { return((UINT)(item>>32)); }
+static UINT   orderSeq(UINT64 item)        { return((UINT)item); }
+//////////////////////////////////////////////////////////////////////////
+// per-key sequence check shared by consumers, each key is seen by one
+// consumer only so its slot needs no lock
+//////////////////////////////////////////////////////////////////////////
+class QueueOrderCheck
+{
+private:
+    std::vector<UINT>   mNext;
+    std::atomic<UINT64> mConsumed;
+    std::atomic<UINT64> mViolations;
+
+public:
+    QueueOrderCheck() : mNext(ORDER_KEYS,0),mConsumed(0),mViolations(0) {}
+    void            check(UINT64 item)
+    {
+        UINT key=orderKey(item);
+        if(key>=ORDER_KEYS || orderSeq(item)!=mNext[key])
+            mViolations.fetch_add(1);
+        else
+            mNext[key]++;
+        mConsumed.fetch_add(1);
+    }
+    UINT64          consumed() const   { return(mConsumed.load()); }
+    UINT64          violations() const { return(mViolations.load()); }
+    bool            complete() const
+    {
+        for(auto it : mNext)
+            if(it!=ORDER_PER_KEY)
+                return(false);
+        return(true);
+    }
+};
+//////////////////////////////////////////////////////////////////////////
+// run producers, each one interleaves sequences of its keys
+//////////////////////////////////////////////////////////////////////////
+static void queueOrderProduce(const std::function<bool(UINT key,UINT64 item)> &push,std::atomic<UINT64> &failed)
+{
+    std::vector<std::thread*> producers;
+    for(UINT p=0;p<ORDER_PRODUCERS;p++)
+        producers.push_back(new std::thread([&push,&failed,p]()
+        {
+            for(UINT seq=0;seq<ORDER_PER_KEY;seq++)
+                for(UINT key=p;key<ORDER_KEYS;key+=ORDER_PRODUCERS)
+                    if(!push(key,orderItem(key,seq)))
+                        failed.fetch_add(1);
+        }));
+    for(auto it : producers)
+    {
+        it->join();
+        delete it;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// tickets keep their order through sharded queue with one consumer per shard
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(ShardedQueueKeyOrder)
+{
+    ShardedQueue<UINT64>      queue;
+    QueueOrderCheck           order;
+    std::atomic<UINT64>       failed(0);
+    std::atomic<bool>         stop(false);
+    std::vector<std::thread*> consumers;
+    TEST_CHECK(queue.init(ORDER_SHARDS,ORDER_CAPACITY,RingQueue<UINT64>::WAIT_BLOCK));
+    // one consumer per shard
+    for(size_t i=0;i<ORDER_SHARDS;i++)
+        consumers.push_back(new std::thread([&queue,&order,&stop,i]()
+        {
+            UINT64 item;
+            while(!stop.load())
+                if(queue.pop(i,item,10))
+                    order.check(item);
+        }));
+    // produce, key is ticket
+    queueOrderProduce([&queue](UINT key,UINT64 item) { return(queue.push(key,item)); },failed);
+    for(int i=0;i<10000 && order.consumed()<(UINT64)ORDER_KEYS*ORDER_PER_KEY;i++)
+        Sleep(1);
+    stop.store(true);
+    queue.shutdown();
+    for(auto it : consumers)
+    {
+        it->join();
+        delete it;
+    }
+    TEST_CHECK(failed.load()==0);
+    TEST_CHECK(order.violations()==0);
+    TEST_CHECK(order.complete() && queue.depth()==0);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// logins keep their order through lane queue, key type fixes its lane
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(LaneQueueKeyOrder)
+{
+    static const UINT weights[LaneQueue<UINT64>::LANE_COUNT]={ 4,1,1 };
+    LaneQueue<UINT64>         queue;
+    QueueOrderCheck           order;
+    std::atomic<UINT64>       failed(0);
+    std::atomic<bool>         stop(false);
+    std::vector<std::thread*> consumers;
+    TEST_CHECK(queue.init("test_order",ORDER_SHARDS,ORDER_CAPACITY,weights));
+    // one consumer per shard
+    for(size_t i=0;i<ORDER_SHARDS;i++)
+        consumers.push_back(new std::thread([&queue,&order,&stop,i]()
+        {
+            UINT64 item;
+            while(!stop.load())
+                if(queue.pop(i,item,10))
+                    order.check(item);
+        }));
+    // produce, key is login, accounts and quotes share shards
+    queueOrderProduce([&queue](UINT key,UINT64 item)
+    {
+        return(queue.push(key,key%2 ? LaneQueue<UINT64>::LANE_ACCOUNT : LaneQueue<UINT64>::LANE_QUOTE,item));
+    },failed);
+    for(int i=0;i<10000 && order.consumed()<(UINT64)ORDER_KEYS*ORDER_PER_KEY;i++)
+        Sleep(1);
+    stop.store(true);
+    queue.shutdown();
+    for(auto it : consumers)
+    {
+        it->join();
+        delete it;
+    }
+    TEST_CHECK(failed.load()==0);
+    TEST_CHECK(order.violations()==0);
+    TEST_CHECK(order.complete() && queue.size()==0);
+    return(true);
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////
+// RingQueueTest.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+#include "../RingQueue.h"
+
+//////////////////////////////////////////////////////////////////////////
+// item of producer and sequence
+//////////////////////////////////////////////////////////////////////////
+static UINT64 ringItem(UINT producer,UINT seq) { return(((UINT64)producer<<32)|seq); }
+//////////////////////////////////////////////////////////////////////////
+// blocking producers and consumers on tiny ring: every item arrives once,
+// each consumer sees items of a producer in push order, sleepers are woken
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(RingQueueBlockStress)
+{
+    enum { PRODUCERS=4,CONSUMERS=4,ITEMS=200000,CAPACITY=8 };
+    RingQueue<UINT64>         queue;
+    std::vector<std::atomic<UINT>> seen(PRODUCERS*ITEMS);
+    std::atomic<UINT64>       consumed(0);
+    std::atomic<UINT64>       violations(0);
+    std::vector<std::thread*> threads;
+    TEST_CHECK(queue.init(CAPACITY,RingQueue<UINT64>::WAIT_BLOCK));
+    for(auto &it : seen)
+        it.store(0);
+    // consumers wait without timeout, shutdown releases them
+    for(UINT c=0;c<CONSUMERS;c++)
+        threads.push_back(new std::thread([&queue,&seen,&consumed,&violations,c]()
+        {
+            std::vector<INT64> last(PRODUCERS,-1);
+            UINT64             item;
+            UINT               count=0;
+            while(queue.pop(item))
+            {
+                UINT producer=(UINT)(item>>32),seq=(UINT)item;
+                if(producer>=PRODUCERS || seq>=ITEMS || (INT64)seq<=last[producer] || seen[producer*ITEMS+seq].fetch_add(1)!=0)
+                    violations.fetch_add(1);
+                else
+                    last[producer]=seq;
+                consumed.fetch_add(1);
+                // stall now and then so producers sleep on full ring
+                if(++count%(1000+c)==0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }));
+    // producers, stalls make consumers sleep on empty ring
+    std::vector<std::thread*> producers;
+    for(UINT p=0;p<PRODUCERS;p++)
+        producers.push_back(new std::thread([&queue,&violations,p]()
+        {
+            for(UINT seq=0;seq<ITEMS;seq++)
+            {
+                if(!queue.push(ringItem(p,seq)))
+                    violations.fetch_add(1);
+                if(seq%(5000+p)==0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }));
+    for(auto it : producers)
+    {
+        it->join();
+        delete it;
+    }
+    // consumers drain the rest and then sleep until shutdown
+    for(int i=0;i<10000 && consumed.load()<(UINT64)PRODUCERS*ITEMS;i++)
+        Sleep(1);
+    queue.shutdown();
+    for(auto it : threads)
+    {
+        it->join();
+        delete it;
+    }
+    TEST_CHECK(violations.load()==0);
+    TEST_CHECK(consumed.load()==(UINT64)PRODUCERS*ITEMS);
+    TEST_CHECK(queue.size()==0);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// blocking pop honours timeout and wakes on push from other thread
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(RingQueueBlockTimeout)
+{
+    RingQueue<UINT64> queue;
+    UINT64            item=0;
+    TEST_CHECK(queue.init(4,RingQueue<UINT64>::WAIT_BLOCK));
+    // empty ring times out
+    std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+    TEST_CHECK(!queue.pop(item,50));
+    TEST_CHECK(std::chrono::steady_clock::now()-start>=std::chrono::milliseconds(50));
+    // sleeping consumer gets item pushed later, long before its timeout
+    std::thread producer([&queue]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.push(42);
+    });
+    start=std::chrono::steady_clock::now();
+    bool popped=queue.pop(item,5000);
+    producer.join();
+    TEST_CHECK(popped && item==42);
+    TEST_CHECK(std::chrono::steady_clock::now()-start<std::chrono::milliseconds(2000));
+    return(true);
+}
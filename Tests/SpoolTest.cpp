@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////////
+// SpoolTest.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+#include "../Spool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// test record, variable fill derived from index follows
+//////////////////////////////////////////////////////////////////////////
+struct SpoolTestRecord
+{
+    UINT64          index;
+    UINT            fill;
+};
+//////////////////////////////////////////////////////////////////////////
+// build record of index
+//////////////////////////////////////////////////////////////////////////
+static UINT spoolTestBuild(UINT64 index,char *buf)
+{
+    SpoolTestRecord rec;
+    rec.index=index;
+    rec.fill =(UINT)(index*7919%251);
+    memcpy(buf,&rec,sizeof(rec));
+    for(UINT i=0;i<rec.fill;i++)
+        buf[sizeof(rec)+i]=(char)(index+i);
+    return(sizeof(rec)+rec.fill);
+}
+//////////////////////////////////////////////////////////////////////////
+// check record against its expected index
+//////////////////////////////////////////////////////////////////////////
+static bool spoolTestCheck(UINT64 index,UINT type,const void *data,UINT size)
+{
+    char buf[sizeof(SpoolTestRecord)+256];
+    UINT expected=spoolTestBuild(index,buf);
+    return(type==(UINT)(index%7)+1 && size==expected && memcmp(data,buf,size)==0);
+}
+//////////////////////////////////////////////////////////////////////////
+// append records [first,last)
+//////////////////////////////////////////////////////////////////////////
+static bool spoolTestAppend(Spool &spool,UINT64 first,UINT64 last)
+{
+    char buf[sizeof(SpoolTestRecord)+256];
+    for(UINT64 i=first;i<last;i++)
+        if(!spool.append((UINT)(i%7)+1,buf,spoolTestBuild(i,buf)))
+            return(false);
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// records survive reopen and replay in order, partial replay resumes
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(SpoolReopenReplay)
+{
+    std::string path=TestRegistry::tempPath("spool_reopen.dat");
+    UINT64      next=0;
+    bool        valid=true;
+    // write and close
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,0));
+        TEST_CHECK(!spool.active());
+        TEST_CHECK(spoolTestAppend(spool,0,1000));
+        spool.shutdown();
+    }
+    // reopen, replay first half and stop
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,0));
+        TEST_CHECK(spool.active());
+        size_t count=spool.replay([&](UINT type,const void *data,UINT size)
+        {
+            if(next==500)
+                return(false);
+            valid=valid && spoolTestCheck(next,type,data,size);
+            next++;
+            return(true);
+        });
+        TEST_CHECK(count==500 && valid);
+        spool.shutdown();
+    }
+    // reopen, replay rest, records appended after reopen go last
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,0));
+        TEST_CHECK(spool.appendIfActive(1000%7+1,"",0));
+        Spool::ReplayFunc func=[&](UINT type,const void *data,UINT size)
+        {
+            // record appended by appendIfActive above is empty
+            if(next==1000)
+                valid=valid && type==1000%7+1 && size==0;
+            else
+                valid=valid && spoolTestCheck(next,type,data,size);
+            next++;
+            return(true);
+        };
+        TEST_CHECK(spool.replay(func)==501 && valid);
+        TEST_CHECK(!spool.active());
+        // drained spool starts over and appendIfActive does not append
+        TEST_CHECK(!spool.appendIfActive(1,"",0));
+        spool.shutdown();
+    }
+    DeleteFileA(path.c_str());
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// spool grows past its initial mapping and keeps records across reopen
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(SpoolGrow)
+{
+    std::string path=TestRegistry::tempPath("spool_grow.dat");
+    const UINT64 total=200000;                  // ~30 MB, larger than grow step
+    UINT64      next=0;
+    bool        valid=true;
+    // write with group flush
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,10));
+        TEST_CHECK(spoolTestAppend(spool,0,total));
+        spool.shutdown();
+    }
+    // replay everything
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,10));
+        size_t count=spool.replay([&](UINT type,const void *data,UINT size)
+        {
+            valid=valid && spoolTestCheck(next++,type,data,size);
+            return(true);
+        });
+        TEST_CHECK(count==total && valid);
+        spool.shutdown();
+    }
+    DeleteFileA(path.c_str());
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// child process appending records until it is killed
+//////////////////////////////////////////////////////////////////////////
+TEST_CHILD(SpoolWriter)
+{
+    Spool  spool;
+    UINT64 index=0;
+    // open
+    if(!spool.init(arg,5))
+        return(1);
+    // append until killed
+    for(;;)
+    {
+        if(!spoolTestAppend(spool,index,index+100))
+            return(2);
+        index+=100;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+// writer killed mid-stream, spool recovers contiguous prefix of records
+//////////////////////////////////////////////////////////////////////////
+TEST_CASE(SpoolKillRecovery)
+{
+    std::string path=TestRegistry::tempPath("spool_kill.dat");
+    UINT64      next=0;
+    bool        valid=true;
+    // start writer and kill it while appending
+    HANDLE process=TestRegistry::spawn("SpoolWriter",path.c_str());
+    TEST_CHECK(process!=nullptr);
+    Sleep(500);
+    TerminateProcess(process,3);
+    WaitForSingleObject(process,INFINITE);
+    CloseHandle(process);
+    // recover and replay, records must be in order without gaps
+    {
+        Spool spool;
+        TEST_CHECK(spool.init(path,0));
+        TEST_CHECK(spool.active());
+        size_t count=spool.replay([&](UINT type,const void *data,UINT size)
+        {
+            valid=valid && spoolTestCheck(next++,type,data,size);
+            return(true);
+        });
+        printf("recovered %I64u records\n",(UINT64)count);
+        TEST_CHECK(count>0 && valid);
+        // recovered spool accepts new records
+        TEST_CHECK(spoolTestAppend(spool,0,10));
+        next=0;
+        TEST_CHECK(spool.replay([&](UINT type,const void *data,UINT size)
+        {
+            valid=valid && spoolTestCheck(next++,type,data,size);
+            return(true);
+        })==10 && valid);
+        spool.shutdown();
+    }
+    DeleteFileA(path.c_str());
+    return(true);
+}
@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////
+// TestMain.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "Tests.h"
+
+//////////////////////////////////////////////////////////////////////////
+// run tests matching filter
+//////////////////////////////////////////////////////////////////////////
+int TestRegistry::run(const char *filter)
+{
+    int failed=0,passed=0;
+    // run in registration order
+    for(auto &it : mTests)
+    {
+        if(filter && strstr(it.name,filter)==nullptr)
+            continue;
+        printf("[ RUN  ] %s\n",it.name);
+        std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+        bool res=it.func();
+        INT64 elapsed=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start).count();
+        printf("[ %s ] %s (%I64d ms)\n",res ? "  OK" : "FAIL",it.name,elapsed);
+        if(res)
+            passed++;
+        else
+            failed++;
+    }
+    printf("%d passed, %d failed\n",passed,failed);
+    return(failed);
+}
+//////////////////////////////////////////////////////////////////////////
+// run child entry point
+//////////////////////////////////////////////////////////////////////////
+int TestRegistry::child(const char *name,const char *arg)
+{
+    for(auto &it : mChildren)
+        if(strcmp(it.name,name)==0)
+            return(it.func(arg));
+    printf("unknown child '%s'\n",name);
+    return(-1);
+}
+//////////////////////////////////////////////////////////////////////////
+// start this executable as child process
+//////////////////////////////////////////////////////////////////////////
+HANDLE TestRegistry::spawn(const char *name,const char *arg)
+{
+    char                path[MAX_PATH];
+    char                cmd[MAX_PATH*2];
+    STARTUPINFOA        si={0};
+    PROCESS_INFORMATION pi={0};
+    // command line
+    if(GetModuleFileNameA(nullptr,path,_countof(path))==0)
+        return(nullptr);
+    _snprintf_s(cmd,_countof(cmd),_TRUNCATE,"\"%s\" --child %s \"%s\"",path,name,arg);
+    // start
+    si.cb=sizeof(si);
+    if(!CreateProcessA(nullptr,cmd,nullptr,nullptr,FALSE,0,nullptr,nullptr,&si,&pi))
+        return(nullptr);
+    CloseHandle(pi.hThread);
+    return(pi.hProcess);
+}
+//////////////////////////////////////////////////////////////////////////
+// unique file in temp directory
+//////////////////////////////////////////////////////////////////////////
+std::string TestRegistry::tempPath(const char *name)
+{
+    char dir[MAX_PATH];
+    char path[MAX_PATH];
+    // checks
+    if(GetTempPathA(_countof(dir),dir)==0)
+        strcpy_s(dir,".\\");
+    _snprintf_s(path,_countof(path),_TRUNCATE,"%stest_%u_%s",dir,GetCurrentProcessId(),name);
+    DeleteFileA(path);
+    return(path);
+}
+//////////////////////////////////////////////////////////////////////////
+// entry point: [filter] or --child <name> <arg>
+//////////////////////////////////////////////////////////////////////////
+int main(int argc,char *argv[])
+{
+    if(argc>=4 && strcmp(argv[1],"--child")==0)
+        return(TestRegistry::get().child(argv[2],argv[3]));
+    return(TestRegistry::get().run(argc>=2 ? argv[1] : nullptr)==0 ? 0 : 1);
+}
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+// Tests.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// type definitions
+//////////////////////////////////////////////////////////////////////////
+typedef bool (*TestFunc)();
+typedef int  (*TestChildFunc)(const char *arg);
+
+//////////////////////////////////////////////////////////////////////////
+// registered tests and child process entry points
+//////////////////////////////////////////////////////////////////////////
+class TestRegistry
+{
+private:
+    struct Test
+    {
+        const char     *name;
+        TestFunc        func;
+    };
+    struct Child
+    {
+        const char     *name;
+        TestChildFunc   func;
+    };
+    std::vector<Test>  mTests;
+    std::vector<Child> mChildren;
+
+public:
+    // singleton
+    static TestRegistry &get() { static TestRegistry registry; return(registry); }
+    // registration
+    bool            add(const char *name,TestFunc func)      { Test  test ={ name,func }; mTests.push_back(test);     return(true); }
+    bool            add(const char *name,TestChildFunc func) { Child child={ name,func }; mChildren.push_back(child); return(true); }
+    // run tests matching filter, returns number of failed ones
+    int             run(const char *filter);
+    // run child entry point, returns process exit code
+    int             child(const char *name,const char *arg);
+    // start this executable as child process
+    static HANDLE   spawn(const char *name,const char *arg);
+    // unique file in temp directory
+    static std::string tempPath(const char *name);
+};
+
+//////////////////////////////////////////////////////////////////////////
+// test definition and checks
+//////////////////////////////////////////////////////////////////////////
+#define TEST_CASE(name)                                                                 \
+    static bool name();                                                                 \
+    static bool name##Registered=TestRegistry::get().add(#name,name);                   \
+    static bool name()
+
+#define TEST_CHILD(name)                                                                \
+    static int name(const char *arg);                                                   \
+    static bool name##Registered=TestRegistry::get().add(#name,name);                   \
+    static int name(const char *arg)
+
+#define TEST_CHECK(cond)                                                                \
+    do { if(!(cond)) { printf("%s(%d): check failed: %s\n",__FILE__,__LINE__,#cond); return(false); } } while(0)
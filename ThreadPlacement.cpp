@@ -0,0 +1,182 @@
+//////////////////////////////////////////////////////////////////////////
+// ThreadPlacement.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "ThreadPlacement.h"
+
+//////////////////////////////////////////////////////////////////////////
+// singleton
+//////////////////////////////////////////////////////////////////////////
+ThreadPlacement &ThreadPlacement::get()
+{
+    static ThreadPlacement placement;
+    return(placement);
+}
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+ThreadPlacement::ThreadPlacement()
+    : mSetDescription(nullptr)
+{
+    for(UINT i=0;i<ROLE_COUNT;i++)
+    {
+        mSettings[i].cpus    =0;
+        mSettings[i].priority=THREAD_PRIORITY_NORMAL;
+        mSettings[i].spread  =false;
+    }
+    // optional API
+    HMODULE kernel=GetModuleHandleA("kernel32.dll");
+    if(kernel)
+        mSetDescription=reinterpret_cast<SetThreadDescriptionFunc>(GetProcAddress(kernel,"SetThreadDescription"));
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+ThreadPlacement::~ThreadPlacement()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// role settings
+//////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::init(int role,const char *cpus,const char *priority,bool spread)
+{
+    Settings settings={0,THREAD_PRIORITY_NORMAL,spread};
+    // checks
+    if(role<0 || role>=ROLE_COUNT)
+        return(false);
+    if(cpus && cpus[0] && !parseCpus(cpus,settings.cpus))
+    {
+        Logger::get().log("invalid thread cpus '%s'",cpus);
+        return(false);
+    }
+    if(priority && priority[0] && !parsePriority(priority,settings.priority))
+    {
+        Logger::get().log("invalid thread priority '%s'",priority);
+        return(false);
+    }
+    // lock
+    mSync.lock();
+    mSettings[role]=settings;
+    // unlock
+    mSync.unlock();
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// name and place calling thread
+//////////////////////////////////////////////////////////////////////////
+void ThreadPlacement::apply(int role,UINT index)
+{
+    static const wchar_t *names[ROLE_COUNT]={ L"manager",L"consumer",L"process",L"database",L"service" };
+    Settings settings;
+    wchar_t  name[64];
+    // checks
+    if(role<0 || role>=ROLE_COUNT)
+        return;
+    // lock
+    mSync.lock();
+    settings=mSettings[role];
+    // unlock
+    mSync.unlock();
+    HANDLE thread=GetCurrentThread();
+    // name for debuggers and profilers
+    if(mSetDescription)
+    {
+        _snwprintf_s(name,_countof(name),_TRUNCATE,L"mt4sql %s #%u",names[role],index);
+        mSetDescription(thread,name);
+    }
+    // pin to CPU set or to single CPU of set by index
+    if(settings.cpus)
+    {
+        UINT64 mask=settings.cpus;
+        if(settings.spread)
+        {
+            UINT cpus[64],count=0;
+            for(UINT i=0;i<64;i++)
+                if(settings.cpus&(1ULL<<i))
+                    cpus[count++]=i;
+            mask=1ULL<<cpus[index%count];
+        }
+        if(!SetThreadAffinityMask(thread,(DWORD_PTR)mask))
+            Logger::get().log("failed to set affinity %I64x of %S thread #%u [%u]",mask,names[role],index,GetLastError());
+        // memory of thread is first touched on node of its ideal CPU
+        DWORD ideal=0;
+        while(!(mask&(1ULL<<ideal)))
+            ideal++;
+        SetThreadIdealProcessor(thread,ideal);
+    }
+    // priority
+    if(settings.priority!=THREAD_PRIORITY_NORMAL && !SetThreadPriority(thread,settings.priority))
+        Logger::get().log("failed to set priority %d of %S thread #%u [%u]",settings.priority,names[role],index,GetLastError());
+}
+//////////////////////////////////////////////////////////////////////////
+// place calling thread once
+//////////////////////////////////////////////////////////////////////////
+void ThreadPlacement::applyOnce(int role,UINT index)
+{
+    static thread_local bool applied=false;
+    // checks
+    if(applied)
+        return;
+    applied=true;
+    apply(role,index);
+}
+//////////////////////////////////////////////////////////////////////////
+// parse CPU list
+//////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::parseCpus(const char *text,UINT64 &mask)
+{
+    mask=0;
+    // checks
+    if(text==nullptr)
+        return(false);
+    // ranges separated by comma
+    while(*text)
+    {
+        char *end;
+        // skip separators
+        if(*text==',' || *text==' ')
+        {
+            text++;
+            continue;
+        }
+        // range start
+        unsigned long from=strtoul(text,&end,10),to;
+        if(end==text)
+            return(false);
+        text=end;
+        to  =from;
+        // range end
+        if(*text=='-')
+        {
+            to=strtoul(text+1,&end,10);
+            if(end==text+1)
+                return(false);
+            text=end;
+        }
+        // group 0 only
+        if(from>to || to>=64)
+            return(false);
+        for(unsigned long i=from;i<=to;i++)
+            mask|=1ULL<<i;
+    }
+    return(mask!=0);
+}
+//////////////////////////////////////////////////////////////////////////
+// parse priority name
+//////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::parsePriority(const char *text,int &priority)
+{
+    // checks
+    if(text==nullptr)
+        return(false);
+    // known names
+    if(_stricmp(text,"idle")==0)     { priority=THREAD_PRIORITY_IDLE;          return(true); }
+    if(_stricmp(text,"low")==0)      { priority=THREAD_PRIORITY_BELOW_NORMAL;  return(true); }
+    if(_stricmp(text,"normal")==0)   { priority=THREAD_PRIORITY_NORMAL;        return(true); }
+    if(_stricmp(text,"high")==0)     { priority=THREAD_PRIORITY_ABOVE_NORMAL;  return(true); }
+    if(_stricmp(text,"highest")==0)  { priority=THREAD_PRIORITY_HIGHEST;       return(true); }
+    if(_stricmp(text,"critical")==0) { priority=THREAD_PRIORITY_TIME_CRITICAL; return(true); }
+    return(false);
+}
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+// ThreadPlacement.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////
+// thread names, CPU sets and priorities by thread role
+//////////////////////////////////////////////////////////////////////////
+class ThreadPlacement
+{
+public:
+    // thread roles
+    enum EnRole
+    {
+        ROLE_MANAGER =0,            // MT4 pumping callbacks
+        ROLE_CONSUMER=1,            // Replication consumers
+        ROLE_PROCESS =2,            // Replication processing
+        ROLE_DATABASE=3,            // database target workers
+        ROLE_SERVICE =4,            // logger, metrics, monitors
+        ROLE_COUNT   =5
+    };
+    // role settings
+    struct Settings
+    {
+        UINT64      cpus;           // affinity mask in processor group 0, 0 - any CPU
+        int         priority;       // THREAD_PRIORITY_*
+        bool        spread;         // pin each thread of role to one CPU of set by index
+    };
+
+private:
+    // synchronizer
+    std::mutex      mSync;
+    Settings        mSettings[ROLE_COUNT];
+    // SetThreadDescription is missing before Windows 10 1607
+    typedef HRESULT (WINAPI *SetThreadDescriptionFunc)(HANDLE,PCWSTR);
+    SetThreadDescriptionFunc mSetDescription;
+
+public:
+    // singleton
+    static ThreadPlacement &get();
+    // role settings from config strings, e.g. cpus "0-3,8" and priority "high"
+    bool            init(int role,const char *cpus,const char *priority,bool spread);
+    // name and place calling thread
+    void            apply(int role,UINT index);
+    // place calling thread once, for threads created by MT4 API
+    void            applyOnce(int role,UINT index);
+    // parse CPU list "0-3,8,10" into mask
+    static bool     parseCpus(const char *text,UINT64 &mask);
+    // parse priority name, returns false if unknown
+    static bool     parsePriority(const char *text,int &priority);
+
+private:
+    // ctor/dtor
+    ThreadPlacement();
+    ~ThreadPlacement();
+};
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+// TransAllocator.cpp
+//
+//////////////////////////////////////////////////////////////////////////
+#include "stdafx.h"
+#include "TransAllocator.h"
+
+//////////////////////////////////////////////////////////////////////////
+// log pool counters
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+static void logPool(const char *name,const ObjectPool<T> &pool)
+{
+    typename ObjectPool<T>::Stats stats=pool.stats();
+    Logger::get().log("%s pool: hits %I64u, misses %I64u, drops %I64u, used %I64u, high-water %I64u",
+                      name,stats.hits,stats.misses,stats.drops,stats.used,stats.highwater);
+}
+//////////////////////////////////////////////////////////////////////////
+// ctor
+//////////////////////////////////////////////////////////////////////////
+TransAllocator::TransAllocator()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// dtor
+//////////////////////////////////////////////////////////////////////////
+TransAllocator::~TransAllocator()
+{
+}
+//////////////////////////////////////////////////////////////////////////
+// singleton
+//////////////////////////////////////////////////////////////////////////
+TransAllocator &TransAllocator::get()
+{
+    static TransAllocator allocator;
+    return(allocator);
+}
+//////////////////////////////////////////////////////////////////////////
+// init pools
+//////////////////////////////////////////////////////////////////////////
+bool TransAllocator::init(size_t capacity,size_t prealloc)
+{
+    // hot path types get full capacity
+    if(!mQuotes.init(capacity,prealloc) ||
+       !mTrades.init(capacity,prealloc) ||
+       !mMargins.init(capacity,prealloc))
+        return(false);
+    // config objects are rare
+    if(!mUsers.init(capacity,0)   ||
+       !mSymbols.init(capacity/16+2,0) ||
+       !mGroups.init(capacity/16+2,0)  ||
+       !mSymbolGroups.init(capacity/16+2,0))
+        return(false);
+    // success
+    return(true);
+}
+//////////////////////////////////////////////////////////////////////////
+// log pools usage
+//////////////////////////////////////////////////////////////////////////
+void TransAllocator::log()
+{
+    logPool("quotes",       mQuotes);
+    logPool("trades",       mTrades);
+    logPool("users",        mUsers);
+    logPool("symbols",      mSymbols);
+    logPool("groups",       mGroups);
+    logPool("symbol groups",mSymbolGroups);
+    logPool("margins",      mMargins);
+}
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////
+// TransAllocator.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+#include "ObjectPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// per-type pools of transactions passed from managers to consumers
+//////////////////////////////////////////////////////////////////////////
+class TransAllocator
+{
+private:
+    // pools
+    ObjectPool<TransQuote>       mQuotes;
+    ObjectPool<TransTrade>       mTrades;
+    ObjectPool<TransUser>        mUsers;
+    ObjectPool<TransSymbol>      mSymbols;
+    ObjectPool<TransGroup>       mGroups;
+    ObjectPool<TransSymbolGroup> mSymbolGroups;
+    ObjectPool<TransMargin>      mMargins;
+
+public:
+    // singleton
+    static TransAllocator &get();
+    // init pools, capacity of free list per type
+    bool            init(size_t capacity,size_t prealloc);
+    // allocate/release transaction of exact type
+    template<class T>
+    T              *alloc()          { return(pool((T*)nullptr).alloc()); }
+    template<class T>
+    void            release(T *trans) { pool(trans).release(trans); }
+    // log pools usage
+    void            log();
+
+private:
+    // ctor/dtor
+    TransAllocator();
+    ~TransAllocator();
+    // pool by type
+    ObjectPool<TransQuote>       &pool(const TransQuote*)       { return(mQuotes);       }
+    ObjectPool<TransTrade>       &pool(const TransTrade*)       { return(mTrades);       }
+    ObjectPool<TransUser>        &pool(const TransUser*)        { return(mUsers);        }
+    ObjectPool<TransSymbol>      &pool(const TransSymbol*)      { return(mSymbols);      }
+    ObjectPool<TransGroup>       &pool(const TransGroup*)       { return(mGroups);       }
+    ObjectPool<TransSymbolGroup> &pool(const TransSymbolGroup*) { return(mSymbolGroups); }
+    ObjectPool<TransMargin>      &pool(const TransMargin*)      { return(mMargins);      }
+};
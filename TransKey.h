@@ -0,0 +1,44 @@
+//////////////////////////////////////////////////////////////////////////
+// TransKey.h
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "Transactions.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ordering keys, transactions with equal key must be applied in order
+//////////////////////////////////////////////////////////////////////////
+namespace TransKey
+{
+    // FNV-1a hash of string key
+    inline size_t hash(const char *str,size_t seed=2166136261u)
+    {
+        unsigned int res=(unsigned int)seed;
+        // checks
+        if(str==nullptr)
+            return(res);
+        // hash bytes
+        for(;*str;str++)
+        {
+            res^=(unsigned char)*str;
+            res*=16777619u;
+        }
+        return(res);
+    }
+    // mix server id into key
+    inline size_t server(int sid,size_t key)
+    {
+        return(key^((size_t)sid*0x9E3779B1u));
+    }
+    // trades, users and margin levels by login to keep per-account order
+    inline size_t key(const TransQuote *trans)       { return(hash(trans->data.symbol)); }
+    inline size_t key(const TransTrade *trans)       { return((size_t)trans->data.login); }
+    inline size_t key(const TransUser *trans)        { return((size_t)trans->data.login); }
+    inline size_t key(const TransSymbol *trans)      { return(hash(trans->data.symbol)); }
+    inline size_t key(const TransGroup *trans)       { return(hash(trans->data.group));  }
+    inline size_t key(const TransSymbolGroup *trans) { return(hash(trans->data.name));   }
+    inline size_t key(const TransMargin *trans)      { return((size_t)trans->data.login); }
+    // key with server id
+    template<class T>
+    inline size_t key(int sid,const T *trans)        { return(server(sid,key(trans))); }
+}